@@ -0,0 +1,255 @@
+﻿#include "BatchPipeline.h"
+#include "BoundedQueue.h"
+#include "ConnectedComponentsRLE.h"
+#include "LabelMapIO.h"
+#include "VisualizationUtils.h"
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <set>
+#include <thread>
+
+using namespace cv;
+using namespace std;
+namespace fs = std::filesystem;
+
+// 在流水线中流动的单帧数据，各阶段用完的中间结果及时释放
+struct Frame {
+    size_t index = 0;
+    string path;
+    Mat gray, binary, labels;
+    int numComponents = 0;
+    vector<uchar> encoded;
+};
+
+static const char* kStageNames[BatchPipeline::kNumStages] = {"decode", "preprocess", "label", "encode", "write"};
+
+// 输出文件名取输入的主文件名；列表文件中不同目录下的同名输入会互相覆盖，
+// 这些输入在主文件名后追加其序号；追加后若与其他输入的主文件名相同（如 a.png 与 a_1.png），序号继续递增
+static vector<string> outputStems(const vector<string>& inputs) {
+    vector<string> stems;
+    map<string, int> count;
+    for (const string& path : inputs) {
+        stems.push_back(fs::path(path).stem().string());
+        ++count[stems.back()];
+    }
+    set<string> used;
+    for (const auto& entry : count) used.insert(entry.first);
+    for (size_t i = 0; i < stems.size(); ++i) {
+        if (count[stems[i]] < 2) continue;
+        size_t n = i;
+        while (used.count(stems[i] + "_" + to_string(n))) ++n;
+        stems[i] += "_" + to_string(n);
+        used.insert(stems[i]);
+    }
+    return stems;
+}
+
+BatchPipeline::Summary BatchPipeline::run(const vector<string>& inputs, const DetectorFactory& factory, const Options& options) {
+    Summary summary;
+    summary.stages.resize(kNumStages);
+
+    int workers[kNumStages];
+    for (int s = 0; s < kNumStages; ++s) workers[s] = max(options.workers[s], 1);
+
+    error_code ec;
+    fs::create_directories(options.outputDir, ec);
+    const vector<string> stems = outputStems(inputs);
+
+    // queues[s] 连接阶段 s 与 s + 1
+    vector<unique_ptr<BoundedQueue<Frame>>> queues;
+    for (int s = 0; s + 1 < kNumStages; ++s) queues.emplace_back(new BoundedQueue<Frame>(options.queueCapacity));
+
+    vector<unique_ptr<IComponentDetector>> detectors;
+    for (int w = 0; w < workers[kLabel]; ++w) detectors.push_back(factory());
+
+    // 融合前端只有 RLE 检测器提供；其他检测器退回到分步预处理
+    vector<ConnectedComponentsRLE*> fusedDetectors;
+    for (auto& d : detectors)
+        if (auto* rle = dynamic_cast<ConnectedComponentsRLE*>(d.get())) fusedDetectors.push_back(rle);
+    const bool fused = options.fused && fusedDetectors.size() == detectors.size();
+    if (options.fused && !fused) cerr << "融合预处理需要 RLE 检测器，改用分步预处理" << endl;
+    const Mat kernel = getStructuringElement(MORPH_RECT, Size(3, 3));
+
+    // 返回 false 表示该帧失败，不再向下游传递
+    auto process = [&](int stage, int worker, Frame& f) -> bool {
+        switch (stage) {
+        case kDecode:
+            f.gray = imread(f.path, IMREAD_GRAYSCALE);
+            if (f.gray.empty()) {
+                cerr << "Failed to load image: " << f.path << endl;
+                return false;
+            }
+            return true;
+        case kPreprocess:
+            // 融合模式下二值化与闭运算推迟到标记阶段逐行完成
+            if (fused) return true;
+            // 与单图模式相同：二值化后做 3x3 闭运算
+            threshold(f.gray, f.binary, options.threshold, 255, THRESH_BINARY);
+            morphologyEx(f.binary, f.binary, MORPH_CLOSE, kernel);
+            f.gray.release();
+            return true;
+        case kLabel: {
+            if (fused) {
+                ConnectedComponentsRLE& detector = *fusedDetectors[worker];
+                f.labels = detector.detectFromGray(f.gray, options.threshold, options.minSize);
+                f.numComponents = detector.numComponents();
+                f.gray.release();
+                return !f.labels.empty();
+            }
+            IComponentDetector& detector = *detectors[worker];
+            detector.detectInto(f.binary, f.labels, options.minSize);
+            f.numComponents = detector.numComponents();
+            f.binary.release();
+            return !f.labels.empty();
+        }
+        case kEncode: {
+            bool ok;
+            if (options.format == kLabelsRle) {
+                ok = LabelMapIO::encodeRle(f.labels, f.numComponents, f.encoded);
+            } else if (options.format == kLabelsRaw) {
+                ok = LabelMapIO::encodeRaw(f.labels, f.numComponents, f.encoded);
+            } else {
+                const Mat color = VisualizationUtils::labelsToColorImage(f.labels, f.numComponents);
+                ok = imencode(".png", color, f.encoded);
+            }
+            f.labels.release();
+            return ok;
+        }
+        default: {
+            static const char* kSuffix[] = {"_color.png", "_labels.ccl", "_labels.raw"};
+            const fs::path out = fs::path(options.outputDir) / (stems[f.index] + kSuffix[options.format]);
+            ofstream file(out, ios::binary);
+            file.write((const char*)f.encoded.data(), (streamsize)f.encoded.size());
+            if (!file) {
+                cerr << "无法写入文件: " << out.string() << endl;
+                return false;
+            }
+            return true;
+        }
+        }
+    };
+
+    atomic<size_t> nextInput{0}, failed{0};
+    atomic<int> remaining[kNumStages];
+    for (int s = 0; s < kNumStages; ++s) remaining[s] = workers[s];
+    mutex statsMutex;
+
+    auto workerLoop = [&](int stage, int worker) {
+        BoundedQueue<Frame>* in = stage > 0 ? queues[stage - 1].get() : nullptr;
+        BoundedQueue<Frame>* out = stage + 1 < kNumStages ? queues[stage].get() : nullptr;
+        size_t items = 0;
+        chrono::steady_clock::duration busy{};
+
+        for (;;) {
+            Frame f;
+            if (in) {
+                if (!in->pop(f)) break;
+            } else {
+                const size_t i = nextInput++;
+                if (i >= inputs.size()) break;
+                f.index = i;
+                f.path = inputs[i];
+            }
+            const auto t0 = chrono::steady_clock::now();
+            const bool ok = process(stage, worker, f);
+            busy += chrono::steady_clock::now() - t0;
+            if (!ok) {
+                ++failed;
+                continue;
+            }
+            ++items;
+            if (out) out->push(std::move(f));
+        }
+
+        {
+            lock_guard<mutex> lock(statsMutex);
+            summary.stages[stage].items += items;
+            summary.stages[stage].busyMs += chrono::duration<double, milli>(busy).count();
+        }
+        // 本阶段最后一个线程退出时关闭下游队列，下游取完剩余数据后依次退出
+        if (--remaining[stage] == 0 && out) out->close();
+    };
+
+    const auto start = chrono::steady_clock::now();
+    vector<thread> threads;
+    for (int s = 0; s < kNumStages; ++s)
+        for (int w = 0; w < workers[s]; ++w) threads.emplace_back(workerLoop, s, w);
+    for (auto& t : threads) t.join();
+    summary.wallMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+    for (int s = 0; s < kNumStages; ++s) {
+        StageStats& st = summary.stages[s];
+        st.name = kStageNames[s];
+        st.workers = workers[s];
+        st.waitInMs = s > 0 ? queues[s - 1]->popWaitMs() : 0.0;
+        st.waitOutMs = s + 1 < kNumStages ? queues[s]->pushWaitMs() : 0.0;
+    }
+    summary.processed = summary.stages[kWrite].items;
+    summary.failed = failed;
+    return summary;
+}
+
+vector<string> BatchPipeline::collectInputs(const string& path) {
+    vector<string> inputs;
+    error_code ec;
+    if (fs::is_directory(path, ec)) {
+        static const char* kExtensions[] = {".png", ".jpg", ".jpeg", ".bmp", ".tif", ".tiff", ".pgm", ".ppm"};
+        for (const auto& entry : fs::directory_iterator(path, ec)) {
+            if (!entry.is_regular_file()) continue;
+            string ext = entry.path().extension().string();
+            transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return (char)tolower(c); });
+            if (find(begin(kExtensions), end(kExtensions), ext) != end(kExtensions)) inputs.push_back(entry.path().string());
+        }
+        sort(inputs.begin(), inputs.end());
+        return inputs;
+    }
+
+    ifstream list(path);
+    if (!list) {
+        cerr << "无法读取输入: " << path << endl;
+        return inputs;
+    }
+    string line;
+    while (getline(list, line)) {
+        // 去掉首尾空白（含 Windows 换行残留的 \r）
+        const size_t b = line.find_first_not_of(" \t\r");
+        if (b == string::npos) continue;
+        const size_t e = line.find_last_not_of(" \t\r");
+        inputs.push_back(line.substr(b, e - b + 1));
+    }
+    return inputs;
+}
+
+void BatchPipeline::printSummary(const Summary& summary) {
+    const double wallSec = summary.wallMs / 1000.0;
+    cout << "批处理完成：成功 " << summary.processed << " 张，失败 " << summary.failed << " 张，总耗时 "
+         << fixed << setprecision(1) << summary.wallMs << " ms" << endl;
+    cout << "------------------------------------------------------------------------------------" << endl;
+    cout << left << setw(12) << "阶段" << right << setw(8) << "线程" << setw(10) << "处理数" << setw(12) << "张/s"
+         << setw(14) << "忙碌(ms)" << setw(10) << "利用率" << setw(16) << "等待输入(ms)" << setw(16) << "等待输出(ms)" << endl;
+    cout << "------------------------------------------------------------------------------------" << endl;
+
+    // 利用率 = 忙碌时间 / (墙钟时间 × 线程数)，最高者为瓶颈阶段
+    int bottleneck = -1;
+    double maxUtil = -1;
+    for (size_t s = 0; s < summary.stages.size(); ++s) {
+        const StageStats& st = summary.stages[s];
+        const double util = wallSec > 0 ? st.busyMs / (summary.wallMs * st.workers) : 0.0;
+        if (util > maxUtil) {
+            maxUtil = util;
+            bottleneck = (int)s;
+        }
+        cout << left << setw(12) << st.name << right << setw(8) << st.workers << setw(10) << st.items
+             << setprecision(1) << setw(12) << (wallSec > 0 ? st.items / wallSec : 0.0) << setw(14) << st.busyMs
+             << setw(9) << util * 100 << "%" << setw(16) << st.waitInMs << setw(16) << st.waitOutMs << endl;
+    }
+    if (bottleneck >= 0) cout << "瓶颈阶段: " << summary.stages[bottleneck].name << endl;
+}
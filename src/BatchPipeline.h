@@ -0,0 +1,53 @@
+﻿#pragma once
+#include "IComponentDetector.h"
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+// 批量处理流水线：解码 -> 预处理（二值化 + 闭运算）-> 标记 -> 着色编码 -> 写盘。
+// 各阶段之间用有界队列连接、各自拥有若干工作线程，I/O 与计算互相重叠。
+// 结束后报告每个阶段的吞吐与阻塞时间，阻塞时间最少、忙碌时间最多的阶段即瓶颈。
+class BatchPipeline {
+public:
+    // 每个标记线程各自创建一个检测器实例
+    using DetectorFactory = std::function<std::unique_ptr<IComponentDetector>()>;
+
+    enum Stage { kDecode, kPreprocess, kLabel, kEncode, kWrite, kNumStages };
+
+    // 输出格式：彩色 PNG，或保留标签编号的标记图（见 LabelMapIO）
+    enum OutputFormat { kColorPng, kLabelsRle, kLabelsRaw };
+
+    struct Options {
+        int workers[kNumStages] = {1, 1, 2, 2, 1};  // 各阶段线程数
+        size_t queueCapacity = 8;                   // 阶段间队列容量
+        std::string outputDir = ".";
+        int threshold = 127;
+        int minSize = 0;
+        bool fused = false;  // 预处理与游程提取逐行融合，不生成整幅二值图；要求工厂创建 RLE 检测器
+        OutputFormat format = kColorPng;
+    };
+
+    struct StageStats {
+        std::string name;
+        int workers = 0;
+        size_t items = 0;
+        double busyMs = 0;     // 所有线程处理数据的累计时间
+        double waitInMs = 0;   // 等待上游数据的累计时间
+        double waitOutMs = 0;  // 下游队列满而阻塞的累计时间
+    };
+
+    struct Summary {
+        size_t processed = 0;  // 成功写出的图像数
+        size_t failed = 0;
+        double wallMs = 0;
+        std::vector<StageStats> stages;
+    };
+
+    static Summary run(const std::vector<std::string>& inputs, const DetectorFactory& factory, const Options& options);
+
+    // 输入可以是目录（取其中的图像文件，按文件名排序）或每行一个路径的列表文件
+    static std::vector<std::string> collectInputs(const std::string& path);
+
+    static void printSummary(const Summary& summary);
+};
@@ -0,0 +1,117 @@
+﻿#include "Benchmark.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <numeric>
+#include <thread>
+
+#if defined(_WIN32)
+#include <windows.h>
+#include <psapi.h>
+#if defined(_MSC_VER)
+#pragma comment(lib, "psapi.lib")
+#endif
+#else
+#include <sys/resource.h>
+#endif
+
+using namespace cv;
+using namespace std;
+
+Benchmark::Result Benchmark::run(IComponentDetector& detector, const string& imageName, const Mat& binary, const Options& options) {
+    Result r;
+    r.image = imageName;
+    r.rows = binary.rows;
+    r.cols = binary.cols;
+    r.detector = detector.name();
+
+    Mat labels;
+    for (int i = 0; i < options.warmup; ++i) detector.detectInto(binary, labels, options.minSize);
+
+    const int reps = max(options.repetitions, 1);
+    vector<double> samples(reps);
+    for (int i = 0; i < reps; ++i) {
+        const auto t0 = chrono::steady_clock::now();
+        detector.detectInto(binary, labels, options.minSize);
+        const auto t1 = chrono::steady_clock::now();
+        samples[i] = chrono::duration<double, milli>(t1 - t0).count();
+    }
+    sort(samples.begin(), samples.end());
+
+    r.repetitions = reps;
+    r.numComponents = detector.numComponents();
+    r.medianMs = percentile(samples, 50);
+    r.p95Ms = percentile(samples, 95);
+    r.p99Ms = percentile(samples, 99);
+    r.meanMs = accumulate(samples.begin(), samples.end(), 0.0) / reps;
+    r.minMs = samples.front();
+    r.maxMs = samples.back();
+    r.mpixPerSec = r.medianMs > 0 ? (double)binary.total() / 1e6 / (r.medianMs / 1000.0) : 0.0;
+    return r;
+}
+
+double Benchmark::percentile(const vector<double>& samples, double p) {
+    if (samples.empty()) return 0.0;
+    const size_t rank = (size_t)ceil(p / 100.0 * samples.size());
+    return samples[min(max(rank, (size_t)1), samples.size()) - 1];
+}
+
+size_t Benchmark::peakRssKb() {
+#if defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS pmc;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc))) return pmc.PeakWorkingSetSize / 1024;
+    return 0;
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+#if defined(__APPLE__)
+    return (size_t)usage.ru_maxrss / 1024;  // macOS 以字节为单位
+#else
+    return (size_t)usage.ru_maxrss;  // Linux 以 KB 为单位
+#endif
+#endif
+}
+
+bool Benchmark::writeCsv(const string& path, const vector<Result>& results) {
+    ofstream out(path);
+    if (!out) {
+        cerr << "无法写入文件: " << path << endl;
+        return false;
+    }
+    out << "image,rows,cols,detector,repetitions,components,median_ms,p95_ms,p99_ms,mean_ms,min_ms,max_ms,mpix_per_s\n";
+    for (const Result& r : results) {
+        out << r.image << ',' << r.rows << ',' << r.cols << ",\"" << r.detector << "\"," << r.repetitions << ','
+            << r.numComponents << ',' << r.medianMs << ',' << r.p95Ms << ',' << r.p99Ms << ',' << r.meanMs << ','
+            << r.minMs << ',' << r.maxMs << ',' << r.mpixPerSec << '\n';
+    }
+    return true;
+}
+
+bool Benchmark::writeJson(const string& path, const vector<Result>& results, const Options& options) {
+    ofstream out(path);
+    if (!out) {
+        cerr << "无法写入文件: " << path << endl;
+        return false;
+    }
+    // 名称只含字母、数字、括号与空格，无需转义
+    out << "{\n";
+    out << "  \"warmup\": " << options.warmup << ",\n";
+    out << "  \"repetitions\": " << options.repetitions << ",\n";
+    out << "  \"min_size\": " << options.minSize << ",\n";
+    out << "  \"hardware_threads\": " << thread::hardware_concurrency() << ",\n";
+    out << "  \"results\": [\n";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const Result& r = results[i];
+        out << "    {\"image\": \"" << r.image << "\", \"rows\": " << r.rows << ", \"cols\": " << r.cols
+            << ", \"detector\": \"" << r.detector << "\", \"repetitions\": " << r.repetitions
+            << ", \"components\": " << r.numComponents << ", \"median_ms\": " << r.medianMs
+            << ", \"p95_ms\": " << r.p95Ms << ", \"p99_ms\": " << r.p99Ms << ", \"mean_ms\": " << r.meanMs
+            << ", \"min_ms\": " << r.minMs << ", \"max_ms\": " << r.maxMs << ", \"mpix_per_s\": " << r.mpixPerSec
+            << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "  ],\n";
+    out << "  \"process_peak_rss_kb\": " << peakRssKb() << "\n}\n";
+    return true;
+}
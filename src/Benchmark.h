@@ -0,0 +1,36 @@
+﻿#pragma once
+#include "IComponentDetector.h"
+#include <string>
+#include <vector>
+
+// 基准测试：每个检测器先预热若干次，再重复计时多次，报告延迟分位数与吞吐；
+// 峰值内存是整个进程的高水位，只能在全部测完后报告一次，不区分各项。
+// 计时使用 detectInto 复用同一个输出矩阵，测得的是稳态（无分配）下的性能。
+class Benchmark {
+public:
+    struct Options {
+        int warmup = 3;
+        int repetitions = 20;
+        int minSize = 0;
+    };
+
+    struct Result {
+        std::string image;
+        int rows = 0, cols = 0;
+        std::string detector;
+        int repetitions = 0;
+        int numComponents = 0;
+        double medianMs = 0, p95Ms = 0, p99Ms = 0, meanMs = 0, minMs = 0, maxMs = 0;
+        double mpixPerSec = 0;  // 按中位数延迟计算
+    };
+
+    static Result run(IComponentDetector& detector, const std::string& imageName, const cv::Mat& binary, const Options& options);
+
+    // 最近秩法分位数，samples 必须已升序排列，p 取 0~100
+    static double percentile(const std::vector<double>& samples, double p);
+    // 进程峰值常驻内存（KB），平台不支持时返回 0
+    static size_t peakRssKb();
+
+    static bool writeCsv(const std::string& path, const std::vector<Result>& results);
+    static bool writeJson(const std::string& path, const std::vector<Result>& results, const Options& options);
+};
@@ -0,0 +1,67 @@
+﻿#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+// 有界阻塞队列，用于流水线各阶段之间传递数据。
+// 队列满时 push 阻塞、空时 pop 阻塞；close() 之后 push 失败，pop 取完剩余元素后返回 false。
+// 同时累计生产者、消费者的阻塞时间，用来定位瓶颈阶段。
+template <typename T>
+class BoundedQueue {
+public:
+    explicit BoundedQueue(size_t capacity) : m_capacity(capacity ? capacity : 1) {}
+
+    bool push(T item) {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if (m_items.size() >= m_capacity && !m_closed) {
+            const auto t0 = std::chrono::steady_clock::now();
+            m_notFull.wait(lock, [&] { return m_items.size() < m_capacity || m_closed; });
+            m_pushWait += std::chrono::steady_clock::now() - t0;
+        }
+        if (m_closed) return false;
+        m_items.push_back(std::move(item));
+        m_notEmpty.notify_one();
+        return true;
+    }
+
+    bool pop(T& item) {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if (m_items.empty() && !m_closed) {
+            const auto t0 = std::chrono::steady_clock::now();
+            m_notEmpty.wait(lock, [&] { return !m_items.empty() || m_closed; });
+            m_popWait += std::chrono::steady_clock::now() - t0;
+        }
+        if (m_items.empty()) return false;
+        item = std::move(m_items.front());
+        m_items.pop_front();
+        m_notFull.notify_one();
+        return true;
+    }
+
+    // 不再接受新元素，唤醒所有等待者
+    void close() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_closed = true;
+        m_notEmpty.notify_all();
+        m_notFull.notify_all();
+    }
+
+    // 生产者因队列满、消费者因队列空而阻塞的累计时间（毫秒，所有线程之和）
+    double pushWaitMs() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return std::chrono::duration<double, std::milli>(m_pushWait).count();
+    }
+    double popWaitMs() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return std::chrono::duration<double, std::milli>(m_popWait).count();
+    }
+
+private:
+    const size_t m_capacity;
+    std::deque<T> m_items;
+    bool m_closed = false;
+    mutable std::mutex m_mutex;
+    std::condition_variable m_notEmpty, m_notFull;
+    std::chrono::steady_clock::duration m_pushWait{}, m_popWait{};
+};
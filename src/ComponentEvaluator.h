@@ -1,6 +1,8 @@
 ﻿#pragma once
 
 #include "IComponentDetector.h"
+#include "Instrumentation.h"
+#include <memory>
 #include <vector>
 
 class ComponentEvaluator {
@@ -11,9 +13,13 @@ public:
         double timeMs;
         double pixelAccuracy;
         double meanIoU;
+        double adjustedRandIndex;  // 调整兰德指数，背景视为一类
         cv::Mat labels;
-        cv::Mat color;
+        cv::Mat color;  // 仅在 withColor 时生成
+        std::shared_ptr<Instrumentation::Profile> profile;  // 该检测器各阶段耗时与计数器（启用插桩时才有内容）
     };
 
-    static std::vector<Result> evaluate(const cv::Mat& binary, const std::vector<IComponentDetector*>& detectors);
+    // withColor 为 false 时不生成彩色图（只输出标记图时省去整幅上色的开销）
+    static std::vector<Result> evaluate(const cv::Mat& binary, const std::vector<IComponentDetector*>& detectors,
+                                        bool withColor = true);
 };
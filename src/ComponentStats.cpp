@@ -0,0 +1,60 @@
+﻿#include "ComponentStats.h"
+#include "LabelingKernels.h"
+#include <climits>
+
+using namespace cv;
+using namespace std;
+
+void ComponentStats::reset(int numComponents, bool withPerimeter) {
+    const size_t n = (size_t)numComponents + 1;
+    area.assign(n, 0);
+    left.assign(n, INT_MAX);
+    top.assign(n, INT_MAX);
+    right.assign(n, -1);
+    bottom.assign(n, -1);
+    m10.assign(n, 0);
+    m01.assign(n, 0);
+    cx.assign(n, 0.0);
+    cy.assign(n, 0.0);
+    if (withPerimeter) perimeter.assign(n, 0);
+    else perimeter.clear();
+}
+
+void ComponentStats::merge(const ComponentStats& other) {
+    for (size_t l = 1; l < area.size(); ++l) {
+        if (!other.area[l]) continue;
+        area[l] += other.area[l];
+        left[l] = min(left[l], other.left[l]);
+        top[l] = min(top[l], other.top[l]);
+        right[l] = max(right[l], other.right[l]);
+        bottom[l] = max(bottom[l], other.bottom[l]);
+        m10[l] += other.m10[l];
+        m01[l] += other.m01[l];
+        if (hasPerimeter() && other.hasPerimeter()) perimeter[l] += other.perimeter[l];
+    }
+}
+
+void ComponentStats::finalize() {
+    for (size_t l = 1; l < area.size(); ++l) {
+        if (!area[l]) continue;
+        cx[l] = (double)m10[l] / area[l];
+        cy[l] = (double)m01[l] / area[l];
+    }
+}
+
+void ComponentStats::fromLabels(const Mat& binary, const Mat& labels, int numComponents, bool withPerimeter, ComponentStats& stats) {
+    stats.reset(numComponents, withPerimeter);
+    LabelingKernels::dispatchLabelType(labels.depth(), [&](auto tag) {
+        using LabelT = typename decltype(tag)::type;
+        for (int y = 0; y < labels.rows; ++y) {
+            const LabelT* lbl = labels.ptr<LabelT>(y);
+            for (int x = 0; x < labels.cols; ++x) {
+                const int l = lbl[x];
+                if (!l) continue;
+                stats.addPixel(l, x, y);
+                if (withPerimeter) stats.perimeter[l] += exposedEdges(binary, y, x);
+            }
+        }
+    });
+    stats.finalize();
+}
@@ -0,0 +1,100 @@
+﻿#pragma once
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <vector>
+
+// 连通域统计表（结构体数组形式）。所有数组都以最终标签为下标，长度为 numComponents + 1，
+// 下标 0 对应背景、不参与统计。
+struct ComponentStats {
+    std::vector<int> area;                    // 像素数（零阶矩 m00）
+    std::vector<int> left, top, right, bottom; // 外接矩形，闭区间
+    std::vector<int64_t> m10, m01;            // 一阶矩：x 之和、y 之和
+    std::vector<double> cx, cy;               // 质心，finalize() 后有效
+    std::vector<int> perimeter;               // 与背景/图像边界相邻的像素边数，仅在请求时填充
+
+    int numComponents() const { return area.empty() ? 0 : (int)area.size() - 1; }
+    bool hasPerimeter() const { return !perimeter.empty(); }
+
+    void reset(int numComponents, bool withPerimeter = false);
+
+    void addPixel(int label, int x, int y) {
+        area[label]++;
+        left[label] = std::min(left[label], x);
+        right[label] = std::max(right[label], x);
+        top[label] = std::min(top[label], y);
+        bottom[label] = std::max(bottom[label], y);
+        m10[label] += x;
+        m01[label] += y;
+    }
+
+    // 一段游程 [x0, x1) 一次性累加
+    void addRun(int label, int y, int x0, int x1) {
+        const int len = x1 - x0;
+        area[label] += len;
+        left[label] = std::min(left[label], x0);
+        right[label] = std::max(right[label], x1 - 1);
+        top[label] = std::min(top[label], y);
+        bottom[label] = std::max(bottom[label], y);
+        m10[label] += (int64_t)(x0 + x1 - 1) * len / 2;
+        m01[label] += (int64_t)y * len;
+    }
+
+    // 合并另一张同样编号的部分统计表（例如并行条带各自累加的结果）
+    void merge(const ComponentStats& other);
+
+    // 计算质心
+    void finalize();
+
+    cv::Rect bbox(int label) const {
+        return cv::Rect(left[label], top[label], right[label] - left[label] + 1, bottom[label] - top[label] + 1);
+    }
+
+    // 像素 (x, y) 四邻域中背景或越界的个数（binary 中 255 为前景）
+    static int exposedEdges(const cv::Mat& binary, int y, int x) {
+        const uchar* row = binary.ptr<uchar>(y);
+        int n = 0;
+        n += (x == 0 || row[x - 1] != 255);
+        n += (x + 1 == binary.cols || row[x + 1] != 255);
+        n += (y == 0 || binary.ptr<uchar>(y - 1)[x] != 255);
+        n += (y + 1 == binary.rows || binary.ptr<uchar>(y + 1)[x] != 255);
+        return n;
+    }
+
+    // 对任意标记矩阵（CV_32S 或 CV_16U）单独扫描一遍统计（供未实现融合统计的检测器使用）
+    static void fromLabels(const cv::Mat& binary, const cv::Mat& labels, int numComponents, bool withPerimeter, ComponentStats& stats);
+};
+
+// 单个连通域的统计记录，供流式、稀疏等逐个输出连通域的接口使用
+struct ComponentRecord {
+    int label = 0;
+    int area = 0;
+    int left = INT_MAX, top = INT_MAX, right = -1, bottom = -1;  // 闭区间
+    int64_t m10 = 0, m01 = 0;
+
+    void addRun(int y, int x0, int x1) {
+        const int len = x1 - x0;
+        area += len;
+        left = std::min(left, x0);
+        right = std::max(right, x1 - 1);
+        top = std::min(top, y);
+        bottom = std::max(bottom, y);
+        m10 += (int64_t)(x0 + x1 - 1) * len / 2;
+        m01 += (int64_t)y * len;
+    }
+
+    void merge(const ComponentRecord& o) {
+        area += o.area;
+        left = std::min(left, o.left);
+        right = std::max(right, o.right);
+        top = std::min(top, o.top);
+        bottom = std::max(bottom, o.bottom);
+        m10 += o.m10;
+        m01 += o.m01;
+    }
+
+    cv::Rect bbox() const { return cv::Rect(left, top, right - left + 1, bottom - top + 1); }
+    double cx() const { return area ? (double)m10 / area : 0.0; }
+    double cy() const { return area ? (double)m01 / area : 0.0; }
+};
@@ -0,0 +1,167 @@
+﻿#include "ComponentTree.h"
+#include "LabelingKernels.h"
+#include <algorithm>
+#include <iostream>
+
+using namespace cv;
+using namespace std;
+
+static int findRoot(vector<int>& zpar, int p) {
+    while (zpar[p] != p) {
+        zpar[p] = zpar[zpar[p]];
+        p = zpar[p];
+    }
+    return p;
+}
+
+int ComponentTree::levelFor(double thresh) {
+    // 与 8 位图像的 THRESH_BINARY 一致：阈值先向下取整，灰度 > t 为前景
+    const double h = floor(thresh) + 1;
+    return h <= 0 ? 0 : h >= 256 ? 256 : (int)h;
+}
+
+void ComponentTree::build(const Mat& gray) {
+    m_level.clear();
+    m_parent.clear();
+    m_area.clear();
+    if (gray.empty() || gray.type() != CV_8UC1) {
+        cerr << "输入必须为单通道灰度图像" << endl;
+        m_rows = m_cols = 0;
+        return;
+    }
+    const int rows = gray.rows, cols = gray.cols;
+    const int total = rows * cols;
+    m_rows = rows;
+    m_cols = cols;
+
+    // 计数排序：m_order 按灰度从高到低排列像素，同灰度内保持光栅顺序
+    int start[257] = {};
+    for (int y = 0; y < rows; ++y) {
+        const uchar* src = gray.ptr<uchar>(y);
+        for (int x = 0; x < cols; ++x) start[255 - src[x] + 1]++;
+    }
+    for (int v = 0; v < 256; ++v) start[v + 1] += start[v];
+    m_order.resize(total);
+    for (int y = 0; y < rows; ++y) {
+        const uchar* src = gray.ptr<uchar>(y);
+        for (int x = 0; x < cols; ++x) m_order[start[255 - src[x]]++] = y * cols + x;
+    }
+
+    // 自高向低并入已处理的邻居：parent 指向后处理（灰度不高于自己）的像素，m_zpar 为加速查找的并查集。
+    // parent 借用 m_nodeOf 的存储，规范化之后再改写为节点编号
+    vector<int>& parent = m_nodeOf;
+    parent.assign(total, -1);
+    m_zpar.assign(total, -1);
+    const Mat cont = gray.isContinuous() ? gray : gray.clone();
+    const uchar* value = cont.ptr<uchar>();
+    for (int i = 0; i < total; ++i) {
+        const int p = m_order[i];
+        const int y = p / cols, x = p % cols;
+        parent[p] = p;
+        m_zpar[p] = p;
+        auto visit = [&](int dy, int nx) {
+            const int n = (y + dy) * cols + nx;
+            if (m_zpar[n] < 0) return;
+            const int r = findRoot(m_zpar, n);
+            if (r == p) return;
+            parent[r] = p;
+            m_zpar[r] = p;
+        };
+        if (m_useEightConnectivity) LabelingKernels::forEachNeighbor<true>(x, y, rows, cols, visit);
+        else LabelingKernels::forEachNeighbor<false>(x, y, rows, cols, visit);
+    }
+
+    // 规范化：逆序（根先于子孙）处理，使同一分量同一灰度的像素都指向该层的代表像素
+    for (int i = total - 1; i >= 0; --i) {
+        const int p = m_order[i];
+        const int q = parent[p];
+        if (value[parent[q]] == value[q]) parent[p] = parent[q];
+    }
+
+    // 代表像素编号为节点，逆序保证父节点先编号；m_zpar 改存像素 -> 节点
+    vector<int>& node = m_zpar;
+    const int root = m_order[total - 1];
+    for (int i = total - 1; i >= 0; --i) {
+        const int p = m_order[i];
+        const int q = parent[p];
+        if (p == root || value[q] != value[p]) {
+            node[p] = (int)m_level.size();
+            m_level.push_back(value[p]);
+            m_parent.push_back(p == root ? -1 : node[q]);
+        } else {
+            node[p] = node[q];
+        }
+    }
+    m_nodeOf.swap(m_zpar);
+
+    // 面积：先计各节点本层的像素，再自叶向根累加
+    m_area.assign(m_level.size(), 0);
+    for (int p = 0; p < total; ++p) m_area[m_nodeOf[p]]++;
+    for (int n = (int)m_level.size() - 1; n > 0; --n) m_area[m_parent[n]] += m_area[n];
+}
+
+int ComponentTree::countAt(double thresh, int minSize) const {
+    const int h = levelFor(thresh);
+    int count = 0;
+    for (size_t n = 0; n < m_level.size(); ++n) {
+        if (m_level[n] >= h && (m_parent[n] < 0 || m_level[m_parent[n]] < h) && m_area[n] >= minSize) ++count;
+    }
+    return count;
+}
+
+vector<int> ComponentTree::countsAllThresholds(int minSize) const {
+    // 节点在阈值 [父节点 level, 自身 level - 1] 上是一个连通域，差分后前缀和
+    vector<int> diff(257, 0);
+    for (size_t n = 0; n < m_level.size(); ++n) {
+        if (m_area[n] < minSize || m_level[n] == 0) continue;
+        const int lo = m_parent[n] < 0 ? 0 : m_level[m_parent[n]];
+        diff[lo]++;
+        diff[m_level[n]]--;
+    }
+    vector<int> counts(256);
+    int running = 0;
+    for (int t = 0; t < 256; ++t) counts[t] = running += diff[t];
+    return counts;
+}
+
+int ComponentTree::labelsAt(double thresh, Mat& labels, int minSize) const {
+    if (empty()) {
+        labels = Mat();
+        return 0;
+    }
+    const int h = levelFor(thresh);
+
+    // 每个节点在该阈值下所属的连通域（其 level >= h 的最高祖先），被过滤或为背景时为 -1
+    vector<int> rep(m_level.size());
+    for (size_t n = 0; n < m_level.size(); ++n) {
+        const int p = m_parent[n];
+        if (m_level[n] < h) rep[n] = -1;
+        else if (p < 0 || m_level[p] < h) rep[n] = m_area[n] >= minSize ? (int)n : -1;
+        else rep[n] = rep[p];
+    }
+
+    // 按光栅顺序首次遇到的先后编号
+    vector<int> id(m_level.size(), 0);
+    int count = 0;
+    if (labels.rows != m_rows || labels.cols != m_cols || labels.type() != CV_32S) labels.create(m_rows, m_cols, CV_32S);
+    for (int y = 0; y < m_rows; ++y) {
+        int* dst = labels.ptr<int>(y);
+        const int* nodeRow = &m_nodeOf[(size_t)y * m_cols];
+        for (int x = 0; x < m_cols; ++x) {
+            const int r = rep[nodeRow[x]];
+            if (r < 0) {
+                dst[x] = 0;
+                continue;
+            }
+            if (!id[r]) id[r] = ++count;
+            dst[x] = id[r];
+        }
+    }
+    return count;
+}
+
+Mat ComponentTree::labelsAt(double thresh, int minSize) const {
+    Mat labels;
+    labelsAt(thresh, labels, minSize);
+    return labels;
+}
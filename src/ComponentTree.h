@@ -0,0 +1,43 @@
+﻿#pragma once
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+// 灰度图的最大树（max-tree）：一次构建即可回答任意阈值下的连通域标记与个数，无需重新二值化、重新标记。
+// 节点是上水平集 {灰度 >= level} 的连通分量，父节点为包含它的、level 更低的分量；
+// 阈值 t 下（THRESH_BINARY：灰度 > t 为前景）的连通域恰好是 level >= t + 1 且父节点 level <= t 的节点。
+// 构建：计数排序后按灰度从高到低把像素并入已处理的邻居（带路径压缩的并查集），再规范化父指针，
+// 整体为近线性时间。节点按“父在子前”的顺序编号，查询都是一遍线性扫描。
+// 3x3 矩形闭运算与阈值化可交换，因此对闭运算后的灰度图建树，结果与先二值化再闭运算一致。
+class ComponentTree {
+public:
+    // 选择4邻域或8邻域，默认4邻域；在 build() 之前设置
+    void setEightConnectivity(bool enabled) { m_useEightConnectivity = enabled; }
+
+    // gray 必须为 CV_8UC1
+    void build(const cv::Mat& gray);
+    bool empty() const { return m_level.empty(); }
+    int numNodes() const { return (int)m_level.size(); }
+
+    // 阈值 thresh 下面积不小于 minSize 的连通域个数，O(节点数)
+    int countAt(double thresh, int minSize = 0) const;
+    // 全部 256 个整数阈值下的连通域个数（下标即阈值），总共 O(节点数)
+    std::vector<int> countsAllThresholds(int minSize = 0) const;
+
+    // 阈值 thresh 下的标记图（CV_32S，按光栅顺序编号，与二值化后用 ConnectedComponentsUF 标记的结果一致），
+    // 返回连通域个数；labels 尺寸与类型一致时复用
+    int labelsAt(double thresh, cv::Mat& labels, int minSize = 0) const;
+    cv::Mat labelsAt(double thresh, int minSize = 0) const;
+
+private:
+    // 阈值 -> 最低前景灰度，范围 [0, 256]
+    static int levelFor(double thresh);
+
+    int m_rows = 0, m_cols = 0;
+    std::vector<int> m_nodeOf;          // 每个像素所属的节点（灰度恰为该节点 level 的那一层）
+    std::vector<uchar> m_level;         // 节点灰度
+    std::vector<int> m_parent;          // 父节点，根为 -1
+    std::vector<int> m_area;            // 节点对应分量的像素数（含所有子孙）
+    std::vector<int> m_order, m_zpar;   // 构建用的临时缓冲，跨调用复用
+
+    bool m_useEightConnectivity = false;
+};
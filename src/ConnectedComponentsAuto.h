@@ -0,0 +1,63 @@
+﻿#pragma once
+#include "ConnectedComponentsBBDT.h"
+#include "ConnectedComponentsBFS.h"
+#include "ConnectedComponentsParallel.h"
+#include "ConnectedComponentsRLE.h"
+#include "ConnectedComponentsUF.h"
+#include <string>
+
+// 自动选择标记引擎：先隔行抽样估计前景占比、游程密度与竖直边缘密度（只读少量行），
+// 再用按基准测试数据拟合的代价模型预测各引擎的耗时，把本次调用交给预计最快的引擎。
+// 被选中的引擎与选择理由通过 lastDecision() 报告；输出与直接调用该引擎完全一致。
+class ConnectedComponentsAuto : public IComponentDetector {
+public:
+    enum Engine { kBFS, kUF, kBBDT, kParallel, kRLE, kNumEngines };
+
+    // 抽样得到的图像特征，均按像素归一化
+    struct Features {
+        double density = 0;       // 前景像素占比
+        double runsPerPixel = 0;  // 每像素的游程数
+        double edgeDensity = 0;   // 与下一行取值不同的像素占比
+        double meanRunLength = 0;
+        int sampledRows = 0;
+    };
+
+    struct Decision {
+        Engine engine = kRLE;
+        Features features;
+        double predictedMs[kNumEngines] = {};  // 不可用的引擎为负
+        std::string reason;
+    };
+
+    cv::Mat detect(const cv::Mat& binary, int minSize = 0) override;
+    std::string name() const override { return m_useEightConnectivity ? "Auto Custom (8)" : "Auto Custom (4)"; }
+    int numComponents() const override { return m_last ? m_last->numComponents() : 0; }
+    void detectInto(const cv::Mat& binary, cv::Mat& labels, int minSize = 0,
+                    ComponentStats* stats = nullptr, bool withPerimeter = false) override;
+
+    // 选择4邻域或8邻域，默认4邻域
+    void setEightConnectivity(bool enabled) { m_useEightConnectivity = enabled; }
+    // 并行引擎的线程数，<= 0 表示使用全部硬件线程；为 1 时不考虑并行引擎
+    void setNumThreads(int numThreads);
+
+    // 只做抽样与决策，不标记
+    Decision decide(const cv::Mat& binary) const;
+    const Decision& lastDecision() const { return m_decision; }
+
+    static Features sample(const cv::Mat& binary);
+    static const char* engineName(Engine engine);
+
+private:
+    // 按当前设置配置好的引擎，与本检测器共用工作区与输出深度
+    IComponentDetector& engine(Engine e);
+
+    ConnectedComponentsBFS m_bfs;
+    ConnectedComponentsUF m_uf;
+    ConnectedComponentsBBDT m_bbdt;
+    ConnectedComponentsParallel m_parallel;
+    ConnectedComponentsRLE m_rle;
+    Decision m_decision;
+    IComponentDetector* m_last = nullptr;
+    int m_numThreads = 0;
+    bool m_useEightConnectivity = false;
+};
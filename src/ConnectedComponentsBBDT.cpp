@@ -0,0 +1,236 @@
+﻿#include "ConnectedComponentsBBDT.h"
+#include "LabelingKernels.h"
+#include <iostream>
+
+using namespace cv;
+using namespace std;
+
+// 8 邻域块扫描。当前块 X 及其邻域像素命名如下（r、c 为 X 左上像素坐标）：
+//
+//      h i j k        <- 第 r-1 行（h 属于 P，i j 属于 Q，k 属于 R）
+//    n o p            <- 第 r   行（n 属于 S）
+//    r s t            <- 第 r+1 行（r 属于 S）
+//
+// X 与 P 连通：o && h；与 Q 连通：(o||p) && (i||j)；与 R 连通：p && k；与 S 连通：(o||s) && (n||r)。
+// 决策树按 Q、P、R、S 的顺序选取标签，并利用已知相邻的像素对跳过多余的合并。
+template <bool Filter>
+void ConnectedComponentsBBDT::scanBlocks8(const Mat& binary, vector<int>& blocks, LabelEquivalence& eq, vector<int>& area) {
+    const int rows = binary.rows, cols = binary.cols;
+    const int bRows = (rows + 1) / 2, bCols = (cols + 1) / 2;
+    blocks.assign((size_t)bRows * bCols, 0);
+
+    for (int br = 0; br < bRows; ++br) {
+        const int r = br * 2;
+        const uchar* rowU = r > 0 ? binary.ptr<uchar>(r - 1) : nullptr;
+        const uchar* row0 = binary.ptr<uchar>(r);
+        const uchar* row1 = r + 1 < rows ? binary.ptr<uchar>(r + 1) : nullptr;
+        int* blk = &blocks[(size_t)br * bCols];
+        const int* blkU = br > 0 ? blk - bCols : nullptr;
+
+        for (int bc = 0; bc < bCols; ++bc) {
+            const int c = bc * 2;
+            const bool hasRight = c + 1 < cols;
+            const bool o = row0[c] == 255;
+            const bool p = hasRight && row0[c + 1] == 255;
+            const bool s = row1 && row1[c] == 255;
+            const bool t = row1 && hasRight && row1[c + 1] == 255;
+            const int count = o + p + s + t;
+            if (count == 0) continue;
+
+            const bool h = rowU && c > 0 && rowU[c - 1] == 255;
+            const bool i = rowU && rowU[c] == 255;
+            const bool j = rowU && hasRight && rowU[c + 1] == 255;
+            const bool k = rowU && c + 2 < cols && rowU[c + 2] == 255;
+            const bool n = c > 0 && row0[c - 1] == 255;
+            const bool rl = row1 && c > 0 && row1[c - 1] == 255;
+
+            const bool connP = o && h;
+            const bool connQ = (o || p) && (i || j);
+            const bool connR = p && k;
+            const bool connS = (o || s) && (n || rl);
+
+            int label;
+            if (connQ) {
+                label = blkU[bc];
+                // j、k 相邻 => Q 与 R 在上一块行已合并
+                if (connR && !(j && k)) label = eq.merge(label, blkU[bc + 1]);
+                // n、i 相邻 => S 与 Q 已合并
+                if (connS && !(n && i)) label = eq.merge(label, blk[bc - 1]);
+                // h、i 相邻 => P 与 Q 已合并；n、h 相邻 => P 与 S 已合并，而 S 刚并入 X
+                if (connP && !i && !n) label = eq.merge(label, blkU[bc - 1]);
+            } else if (connP) {
+                label = blkU[bc - 1];
+                if (connR) label = eq.merge(label, blkU[bc + 1]);
+                if (connS && !n) label = eq.merge(label, blk[bc - 1]);
+            } else if (connR) {
+                label = blkU[bc + 1];
+                if (connS) label = eq.merge(label, blk[bc - 1]);
+            } else if (connS) {
+                label = blk[bc - 1];
+            } else {
+                label = eq.newLabel();
+                if constexpr (Filter) area.push_back(0);
+            }
+            blk[bc] = label;
+            if constexpr (Filter) area[label] += count;
+        }
+    }
+}
+
+// 4 邻域逐像素扫描：只需看上方 u 与左方 l；若左上像素为前景，u 与 l 已经连通，无需合并
+template <bool Filter>
+void ConnectedComponentsBBDT::scanPixels4(const Mat& binary, Mat& labels, LabelEquivalence& eq, vector<int>& area) {
+    const int rows = binary.rows, cols = binary.cols;
+    for (int y = 0; y < rows; ++y) {
+        const uchar* src = binary.ptr<uchar>(y);
+        const uchar* srcU = y > 0 ? binary.ptr<uchar>(y - 1) : nullptr;
+        int* dst = labels.ptr<int>(y);
+        const int* dstU = y > 0 ? labels.ptr<int>(y - 1) : nullptr;
+
+        for (int x = 0; x < cols; ++x) {
+            if (src[x] != 255) {
+                dst[x] = 0;
+                continue;
+            }
+            const bool u = srcU && srcU[x] == 255;
+            const bool l = x > 0 && src[x - 1] == 255;
+
+            int label;
+            if (u) {
+                label = dstU[x];
+                if (l && !(srcU[x - 1] == 255)) label = eq.merge(label, dst[x - 1]);
+            } else if (l) {
+                label = dst[x - 1];
+            } else {
+                label = eq.newLabel();
+                if constexpr (Filter) area.push_back(0);
+            }
+            dst[x] = label;
+            if constexpr (Filter) area[label]++;
+        }
+    }
+}
+
+// 第二遍扫描：按光栅顺序首次出现的先后分配最终标签（与 Union-Find 版本一致）。
+// 8 邻域从块标签取临时标签，4 邻域从 prov 取
+template <bool Eight, typename LabelT, bool Filter>
+int ConnectedComponentsBBDT::relabel(const Mat& binary, const vector<int>& blocks, const Mat& prov, const LabelEquivalence& eq,
+                                     const vector<int>& area, int minSize, vector<int>& labelMap, Mat& labels,
+                                     ComponentStats* stats, bool withPerimeter) {
+    const int rows = binary.rows, cols = binary.cols;
+    const int blockCols = (cols + 1) / 2;
+    const vector<int>& root = eq.parent;
+    int nextLabel = 0;
+    for (int y = 0; y < rows; ++y) {
+        const uchar* src = binary.ptr<uchar>(y);
+        LabelT* dst = labels.ptr<LabelT>(y);
+        const int* blk = nullptr;
+        const int* lbl = nullptr;
+        if constexpr (Eight) blk = &blocks[(size_t)(y >> 1) * blockCols];
+        else lbl = prov.ptr<int>(y);
+
+        for (int x = 0; x < cols; ++x) {
+            if (src[x] != 255) {
+                dst[x] = 0;
+                continue;
+            }
+            int r;
+            if constexpr (Eight) r = root[blk[x >> 1]];
+            else r = root[lbl[x]];
+            if constexpr (Filter) {
+                if (area[r] < minSize) {
+                    dst[x] = 0;
+                    continue;
+                }
+            }
+            if (labelMap[r] == 0) labelMap[r] = ++nextLabel;
+            const int label = labelMap[r];
+            dst[x] = (LabelT)label;
+            if (stats) {
+                stats->addPixel(label, x, y);
+                if (withPerimeter) stats->perimeter[label] += ComponentStats::exposedEdges(binary, y, x);
+            }
+        }
+    }
+    return nextLabel;
+}
+
+Mat ConnectedComponentsBBDT::detect(const Mat& binary, int minSize) {
+    Mat labels;
+    detectInto(binary, labels, minSize);
+    return labels;
+}
+
+void ConnectedComponentsBBDT::detectInto(const Mat& binary, Mat& labels, int minSize, ComponentStats* stats, bool withPerimeter) {
+    if (binary.empty() || binary.type() != CV_8UC1) {
+        cerr << "输入必须为单通道二值图像" << endl;
+        labels = Mat();
+        return;
+    }
+
+    CC_PHASES();
+    CC_PHASE("scan");
+    const int rows = binary.rows, cols = binary.cols;
+    const int blockCols = (cols + 1) / 2;
+    const bool eight = m_useEightConnectivity;
+    const bool filter = minSize > 1;
+    DetectorWorkspace& ws = workspace();
+
+    LabelEquivalence& eq = ws.get<LabelEquivalence>(kEquivalence);
+    vector<int>& area = ws.get<vector<int>>(kProvArea);
+    vector<int>& blocks = ws.get<vector<int>>(kBlockLabels);
+    eq.reset();
+    area.assign(1, 0);
+    const size_t eqCapacity = eq.parent.capacity(), areaCapacity = area.capacity();
+
+    // 4 邻域的临时标签写在 CV_32S 矩阵上：输出为 CV_32S 时就是输出本身，否则用工作区里的临时矩阵
+    const bool inPlace = labelDepth() == CV_32S;
+    Mat& prov = inPlace ? labels : ws.get<Mat>(kProvisional);
+
+    // 第一遍扫描：临时标签 + 等价关系（仅在需要过滤时累计面积）
+    LabelingKernels::dispatch(eight, filter, [&](auto eightTag, auto filterTag) {
+        constexpr bool Filter = decltype(filterTag)::value;
+        if constexpr (decltype(eightTag)::value) {
+            ws.reserve(blocks, (size_t)((rows + 1) / 2) * blockCols);
+            scanBlocks8<Filter>(binary, blocks, eq, area);
+        } else {
+            ws.prepare(prov, rows, cols, CV_32S);
+            scanPixels4<Filter>(binary, prov, eq, area);
+        }
+    });
+    ws.noteGrowth(eq.parent, eqCapacity);
+    ws.noteGrowth(area, areaCapacity);
+    CC_COUNT(kProvisionalLabels, eq.size() - 1);
+    CC_FLUSH(eq.counters);
+
+    // 解析等价表，并把各临时标签的像素数累加到根上
+    CC_PHASE("resolve");
+    eq.flatten();
+    const vector<int>& root = eq.parent;
+    if (filter) {
+        for (int l = 1; l < eq.size(); ++l) {
+            if (root[l] != l) area[root[l]] += area[l];
+        }
+    }
+    // 统计表与输出深度都需要预先知道保留的连通域个数
+    int kept = 0;
+    for (int l = 1; l < eq.size(); ++l)
+        if (root[l] == l && (!filter || area[l] >= minSize)) ++kept;
+    if (stats) stats->reset(kept, withPerimeter);
+
+    CC_PHASE("relabel");
+    vector<int>& labelMap = ws.get<vector<int>>(kLabelMap);
+    ws.assign(labelMap, (size_t)eq.size(), 0);
+    const int depth = outputDepth(kept);
+    if (eight || !inPlace) ws.prepare(labels, rows, cols, depth);
+    int nextLabel = 0;
+    LabelingKernels::dispatch(eight, filter, [&](auto eightTag, auto filterTag) {
+        LabelingKernels::dispatchLabelType(depth, [&](auto tag) {
+            nextLabel = relabel<decltype(eightTag)::value, typename decltype(tag)::type, decltype(filterTag)::value>(
+                binary, blocks, prov, eq, area, minSize, labelMap, labels, stats, withPerimeter);
+        });
+    });
+    if (stats) stats->finalize();
+
+    m_numComponents = nextLabel;
+}
@@ -0,0 +1,40 @@
+﻿#pragma once
+#include "IComponentDetector.h"
+#include "LabelEquivalence.h"
+#include <vector>
+
+// 基于块的决策树标记（BBDT）。
+// 8 邻域：以 2x2 块为单位扫描，块内前景像素必然互相连通，每块只分配一个临时标签，
+// 通过决策树决定需要检查哪些相邻块（左上 P、上 Q、右上 R、左 S）。
+// 4 邻域：块内对角像素不连通，退化为逐像素的决策树扫描。
+// 最终按光栅顺序重新编号，输出与 ConnectedComponentsUF 完全一致。
+class ConnectedComponentsBBDT : public IComponentDetector {
+public:
+    cv::Mat detect(const cv::Mat& binary, int minSize = 0) override;
+    std::string name() const override { return m_useEightConnectivity ? "BBDT Custom (8)" : "BBDT Custom (4)"; }
+    int numComponents() const override { return m_numComponents; }
+    void detectInto(const cv::Mat& binary, cv::Mat& labels, int minSize = 0,
+                    ComponentStats* stats = nullptr, bool withPerimeter = false) override;
+
+    // 选择4邻域或8邻域，默认4邻域
+    void setEightConnectivity(bool enabled) { m_useEightConnectivity = enabled; }
+
+private:
+    // 工作区中的缓冲区编号
+    enum { kEquivalence, kBlockLabels, kProvArea, kLabelMap, kProvisional };
+
+    // 第一遍扫描：写入临时标签（8 邻域写入 blocks，每块一个；4 邻域写入 labels），
+    // Filter 时在 area 中累计每个临时标签的像素数
+    template <bool Filter>
+    static void scanBlocks8(const cv::Mat& binary, std::vector<int>& blocks, LabelEquivalence& eq, std::vector<int>& area);
+    template <bool Filter>
+    static void scanPixels4(const cv::Mat& binary, cv::Mat& labels, LabelEquivalence& eq, std::vector<int>& area);
+    // 第二遍扫描：解析临时标签并写入 LabelT 类型的输出，返回连通域数
+    template <bool Eight, typename LabelT, bool Filter>
+    static int relabel(const cv::Mat& binary, const std::vector<int>& blocks, const cv::Mat& prov, const LabelEquivalence& eq,
+                       const std::vector<int>& area, int minSize, std::vector<int>& labelMap, cv::Mat& labels,
+                       ComponentStats* stats, bool withPerimeter);
+
+    int m_numComponents = 0;
+    bool m_useEightConnectivity = false;
+};
@@ -1,4 +1,5 @@
 ﻿#include "ConnectedComponentsBFS.h"
+#include "LabelingKernels.h"
 #include <queue>
 #include <iostream>
 
@@ -11,86 +12,146 @@ std::string ConnectedComponentsBFS::name() const {
 }
 
 Mat ConnectedComponentsBFS::detect(const cv::Mat& binary, int minSize, bool useEightConnectivity) {
-    if (binary.empty() || binary.type() != CV_8UC1) {
-        cerr << "输入必须为单通道二值图像" << endl;
-        return Mat();
-    }
-
-    int rows = binary.rows, cols = binary.cols;
-    Mat labels = Mat::zeros(rows, cols, CV_32S);
-
-    // 邻域偏移：根据 4 邻域或 8 邻域选择
-    static const int dx4[4] = {-1, 1, 0, 0};
-    static const int dy4[4] = {0, 0, -1, 1};
-    static const int dx8[8] = {-1, -1, -1, 0, 0, 1, 1, 1};
-    static const int dy8[8] = {-1, 0, 1, -1, 1, -1, 0, 1};
-    const int* dx = useEightConnectivity ? dx8 : dx4;
-    const int* dy = useEightConnectivity ? dy8 : dy4;
-    const int K = useEightConnectivity ? 8 : 4;
+    Mat labels;
+    detectImpl(binary, labels, minSize, useEightConnectivity, nullptr, false);
+    return labels;
+}
 
-    vector<int> compSizes;
-    compSizes.reserve(1000); // 预分配空间，减少realloc
+void ConnectedComponentsBFS::detectInto(const cv::Mat& binary, cv::Mat& labels, int minSize, ComponentStats* stats, bool withPerimeter) {
+    detectImpl(binary, labels, minSize, m_useEightConnectivity, stats, withPerimeter);
+}
 
-    vector<Point> queue(rows * cols);
+template <bool Eight>
+void ConnectedComponentsBFS::floodScan(const Mat& binary, Mat& prov, vector<int>& compSizes, vector<Point>& queue) {
+    const int rows = binary.rows, cols = binary.cols;
     int head = 0, tail = 0;
+    CC_INSTR(int peak = 0;)
 
-    // 第一遍扫描：标记所有连通域
     for (int y = 0; y < rows; ++y) {
+        const uchar* src = binary.ptr<uchar>(y);
+        int* lbl = prov.ptr<int>(y);
         for (int x = 0; x < cols; ++x) {
-            if (binary.at<uchar>(y, x) == 255 && labels.at<int>(y, x) == 0) {
-                // 发现新连通域
-                int currentLabel = (int)compSizes.size() + 1;
-                int count = 0;
-
-                head = tail = 0;  // 重置队列
-                queue[tail++] = Point(x, y);
-                labels.at<int>(y, x) = currentLabel;
-
-                while (head < tail) {
-                    Point p = queue[head++];  // 出队
-                    count++;
-
-                    // 遍历邻域
-                    for (int k = 0; k < K; ++k) {
-                        int nx = p.x + dx[k];
-                        int ny = p.y + dy[k];
-
-                        // 边界检查
-                        if (nx >= 0 && nx < cols && ny >= 0 && ny < rows) {
-                            if (binary.at<uchar>(ny, nx) == 255 && labels.at<int>(ny, nx) == 0) {
-                                labels.at<int>(ny, nx) = currentLabel;
-                                queue[tail++] = Point(nx, ny);  // 入队
-                            }
-                        }
-                    }
+            if (src[x] != 255 || lbl[x] != 0) continue;
+
+            // 发现新连通域
+            const int currentLabel = (int)compSizes.size() + 1;
+            int count = 0;
+
+            head = tail = 0;  // 重置队列
+            queue[tail++] = Point(x, y);
+            lbl[x] = currentLabel;
+
+            while (head < tail) {
+                const Point p = queue[head++];  // 出队
+                count++;
+
+                // 取出 p 上、中、下三行的行指针，邻域展开为固定序列
+                const uchar* srcRows[3];
+                int* lblRows[3];
+                for (int k = 0; k < 3; ++k) {
+                    const int ny = p.y + k - 1;
+                    const bool inside = ny >= 0 && ny < rows;
+                    srcRows[k] = inside ? binary.ptr<uchar>(ny) : nullptr;
+                    lblRows[k] = inside ? prov.ptr<int>(ny) : nullptr;
                 }
-
-                compSizes.push_back(count);
+                LabelingKernels::forEachNeighbor<Eight>(p.x, p.y, rows, cols, [&](int dy, int nx) {
+                    if (srcRows[dy + 1][nx] == 255 && lblRows[dy + 1][nx] == 0) {
+                        lblRows[dy + 1][nx] = currentLabel;
+                        queue[tail++] = Point(nx, p.y + dy);  // 入队
+                    }
+                });
+                CC_INSTR(peak = max(peak, tail - head);)
             }
+
+            compSizes.push_back(count);
         }
     }
+    CC_MAX(kBfsQueuePeak, peak);
+}
 
-    // 第二遍扫描：过滤小连通域并重新映射标签
-    int newLabel = 0;
-    Mat filtered = Mat::zeros(rows, cols, CV_32S);
-    vector<int> valid(compSizes.size() + 1, 0);
-
-    for (size_t i = 0; i < compSizes.size(); ++i) {
-        if (compSizes[i] >= minSize) {
-            valid[i + 1] = ++newLabel;  // 旧标签 -> 新标签
+template <typename LabelT, bool Filter>
+void ConnectedComponentsBFS::relabel(const Mat& binary, const Mat& prov, const vector<int>& valid, Mat& labels,
+                                     ComponentStats* stats, bool withPerimeter) {
+    // prov 与 labels 可以是同一个 CV_32S 矩阵（原地重映射）
+    for (int y = 0; y < prov.rows; ++y) {
+        const int* src = prov.ptr<int>(y);
+        LabelT* dst = labels.ptr<LabelT>(y);
+        for (int x = 0; x < prov.cols; ++x) {
+            int label = src[x];
+            if constexpr (Filter) label = valid[label];
+            dst[x] = (LabelT)label;
+            if (stats && label) {
+                stats->addPixel(label, x, y);
+                if (withPerimeter) stats->perimeter[label] += ComponentStats::exposedEdges(binary, y, x);
+            }
         }
     }
+}
 
-    // 应用过滤和标签映射
-    for (int y = 0; y < rows; ++y) {
-        for (int x = 0; x < cols; ++x) {
-            int oldLabel = labels.at<int>(y, x);
-            if (oldLabel > 0 && valid[oldLabel] > 0) {
-                filtered.at<int>(y, x) = valid[oldLabel];
+void ConnectedComponentsBFS::detectImpl(const cv::Mat& binary, cv::Mat& labels, int minSize, bool useEightConnectivity,
+                                        ComponentStats* stats, bool withPerimeter) {
+    if (binary.empty() || binary.type() != CV_8UC1) {
+        cerr << "输入必须为单通道二值图像" << endl;
+        labels = Mat();
+        return;
+    }
+
+    CC_PHASES();
+    CC_PHASE("init");
+    int rows = binary.rows, cols = binary.cols;
+    const size_t total = (size_t)rows * cols;
+    DetectorWorkspace& ws = workspace();
+    // 临时标签（0 同时表示“未访问”）：输出为 CV_32S 时直接写在输出上，否则写在工作区的临时矩阵里
+    const bool inPlace = labelDepth() == CV_32S;
+    Mat& prov = inPlace ? labels : ws.get<Mat>(kProvisional);
+    ws.prepare(prov, rows, cols, CV_32S);
+    prov.setTo(Scalar(0));
+
+    vector<int>& compSizes = ws.get<vector<int>>(kCompSizes);
+    compSizes.clear();
+    const size_t compCapacity = compSizes.capacity();
+
+    vector<Point>& queue = ws.get<vector<Point>>(kQueue);
+    ws.reserve(queue, total);
+    queue.resize(total);
+
+    // 第一遍扫描：标记所有连通域
+    CC_PHASE("flood");
+    if (useEightConnectivity) floodScan<true>(binary, prov, compSizes, queue);
+    else floodScan<false>(binary, prov, compSizes, queue);
+
+    ws.noteGrowth(compSizes, compCapacity);
+    CC_COUNT(kProvisionalLabels, compSizes.size());
+
+    // 过滤小连通域：旧标签 -> 新标签
+    const bool filter = minSize > 1;
+    int newLabel = 0;
+    vector<int>& valid = ws.get<vector<int>>(kValid);
+    if (filter) {
+        ws.assign(valid, compSizes.size() + 1, 0);
+        for (size_t i = 0; i < compSizes.size(); ++i) {
+            if (compSizes[i] >= minSize) {
+                valid[i + 1] = ++newLabel;
             }
         }
+    } else {
+        newLabel = (int)compSizes.size();
+    }
+
+    // 第二遍扫描：应用过滤和标签映射，需要时顺带累加统计量。
+    // 不过滤、不要统计量且原地输出时，第一遍的结果已经是最终结果
+    const int depth = outputDepth(newLabel);
+    if (stats) stats->reset(newLabel, withPerimeter);
+    if (filter || stats || !inPlace || depth != CV_32S) {
+        CC_PHASE("relabel");
+        if (!inPlace) ws.prepare(labels, rows, cols, depth);
+        LabelingKernels::dispatchLabelType(depth, [&](auto tag) {
+            using LabelT = typename decltype(tag)::type;
+            if (filter) relabel<LabelT, true>(binary, prov, valid, labels, stats, withPerimeter);
+            else relabel<LabelT, false>(binary, prov, valid, labels, stats, withPerimeter);
+        });
     }
+    if (stats) stats->finalize();
 
     m_numComponents = newLabel;
-    return filtered;
 }
@@ -1,5 +1,6 @@
 ﻿#pragma once
 #include "IComponentDetector.h"
+#include <vector>
 
 class ConnectedComponentsBFS : public IComponentDetector {
 public:
@@ -8,8 +9,24 @@ public:
     void setEightConnectivity(bool enabled) { m_useEightConnectivity = enabled; }
     std::string name() const override;
     int numComponents() const override { return m_numComponents; }
+    void detectInto(const cv::Mat& binary, cv::Mat& labels, int minSize = 0,
+                    ComponentStats* stats = nullptr, bool withPerimeter = false) override;
 
 private:
+    // 工作区中的缓冲区编号
+    enum { kCompSizes, kQueue, kValid, kProvisional };
+
+    void detectImpl(const cv::Mat& binary, cv::Mat& labels, int minSize, bool useEightConnectivity,
+                    ComponentStats* stats, bool withPerimeter);
+
+    // 第一遍：逐个种子广度优先填充，临时标签按种子的光栅顺序编号，compSizes 记录各连通域像素数
+    template <bool Eight>
+    static void floodScan(const cv::Mat& binary, cv::Mat& prov, std::vector<int>& compSizes, std::vector<cv::Point>& queue);
+    // 第二遍：临时标签经 valid 查表写入 LabelT 类型的输出；不过滤时临时标签就是最终标签，无需查表
+    template <typename LabelT, bool Filter>
+    static void relabel(const cv::Mat& binary, const cv::Mat& prov, const std::vector<int>& valid, cv::Mat& labels,
+                        ComponentStats* stats, bool withPerimeter);
+
     int m_numComponents = 0;
     bool m_useEightConnectivity = false;
 };
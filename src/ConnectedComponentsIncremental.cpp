@@ -0,0 +1,457 @@
+﻿#include "ConnectedComponentsIncremental.h"
+#include "LabelingKernels.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+using namespace cv;
+using namespace std;
+
+// 碎片图上的并查集：路径减半，较小的下标做根
+static int findNode(vector<int>& parent, int x) {
+    while (parent[x] != x) {
+        parent[x] = parent[parent[x]];
+        x = parent[x];
+    }
+    return x;
+}
+
+static void uniteNodes(vector<int>& parent, int a, int b) {
+    a = findNode(parent, a);
+    b = findNode(parent, b);
+    if (a < b) parent[b] = a;
+    else if (b < a) parent[a] = b;
+}
+
+void ConnectedComponentsIncremental::setEightConnectivity(bool enabled) {
+    if (enabled != m_useEightConnectivity) reset();
+    m_useEightConnectivity = enabled;
+}
+
+void ConnectedComponentsIncremental::setTileSize(int tileSize) {
+    tileSize = max(tileSize, 1);
+    if (tileSize != m_tileSize) reset();
+    m_tileSize = tileSize;
+}
+
+void ConnectedComponentsIncremental::reset() {
+    m_valid = false;
+    m_maxLabel = 0;
+    m_numComponents = 0;
+}
+
+void ConnectedComponentsIncremental::initTiles(int rows, int cols) {
+    m_tilesX = (cols + m_tileSize - 1) / m_tileSize;
+    m_tilesY = (rows + m_tileSize - 1) / m_tileSize;
+    m_tiles.assign((size_t)m_tilesX * m_tilesY, Tile());
+    for (int ty = 0; ty < m_tilesY; ++ty) {
+        for (int tx = 0; tx < m_tilesX; ++tx) {
+            Tile& tile = m_tiles[(size_t)ty * m_tilesX + tx];
+            const int x0 = tx * m_tileSize, y0 = ty * m_tileSize;
+            tile.rect = Rect(x0, y0, min(m_tileSize, cols - x0), min(m_tileSize, rows - y0));
+            tile.tx = tx;
+            tile.ty = ty;
+        }
+    }
+    workspace().noteAllocation(m_tiles.size() * sizeof(Tile));
+}
+
+const ConnectedComponentsIncremental::Tile* ConnectedComponentsIncremental::neighbor(const Tile& tile, int dir) const {
+    static const int kDx[kNumLinks] = {1, 0, 1, -1};
+    static const int kDy[kNumLinks] = {0, 1, 1, 1};
+    const int tx = tile.tx + kDx[dir], ty = tile.ty + kDy[dir];
+    if (tx < 0 || tx >= m_tilesX || ty >= m_tilesY) return nullptr;
+    return &m_tiles[(size_t)ty * m_tilesX + tx];
+}
+
+// 块及其 1 像素外圈内是否有像素发生变化；外圈变化会影响块边缘像素的周长
+bool ConnectedComponentsIncremental::tileChanged(const Mat& binary, const Tile& tile) const {
+    const int x0 = max(tile.rect.x - 1, 0), x1 = min(tile.rect.x + tile.rect.width + 1, binary.cols);
+    const int y0 = max(tile.rect.y - 1, 0), y1 = min(tile.rect.y + tile.rect.height + 1, binary.rows);
+    for (int y = y0; y < y1; ++y)
+        if (memcmp(binary.ptr<uchar>(y) + x0, m_prev.ptr<uchar>(y) + x0, (size_t)(x1 - x0)) != 0) return true;
+    return false;
+}
+
+// 块内两遍扫描：第一遍分配临时标签并记录等价，第二遍压缩为连续的局部标签，
+// 同时累加碎片统计量，并按游程统计与上一帧编号的重叠
+template <bool Eight>
+void ConnectedComponentsIncremental::relabelTile(const Mat& binary, Tile& tile) {
+    const int x0 = tile.rect.x, x1 = tile.rect.x + tile.rect.width;
+    const int y0 = tile.rect.y, y1 = tile.rect.y + tile.rect.height;
+    LabelEquivalence& eq = tile.equiv;
+    eq.reset();
+
+    for (int y = y0; y < y1; ++y) {
+        const uchar* src = binary.ptr<uchar>(y);
+        const uchar* srcU = y > y0 ? binary.ptr<uchar>(y - 1) : nullptr;
+        int* dst = m_local.ptr<int>(y);
+        const int* dstU = y > y0 ? m_local.ptr<int>(y - 1) : nullptr;
+
+        for (int x = x0; x < x1; ++x) {
+            if (src[x] != 255) {
+                dst[x] = 0;
+                continue;
+            }
+            const bool d = x > x0 && src[x - 1] == 255;  // 左
+            int label;
+            if constexpr (!Eight) {
+                const bool b = srcU && srcU[x] == 255;  // 上
+                if (b) {
+                    label = dstU[x];
+                    if (d && srcU[x - 1] != 255) label = eq.merge(label, dst[x - 1]);
+                } else if (d) {
+                    label = dst[x - 1];
+                } else {
+                    label = eq.newLabel();
+                }
+            } else {
+                //  a b c
+                //  d x
+                const bool a = srcU && x > x0 && srcU[x - 1] == 255;
+                const bool b = srcU && srcU[x] == 255;
+                const bool c = srcU && x + 1 < x1 && srcU[x + 1] == 255;
+                if (b) {
+                    label = dstU[x];
+                } else if (c) {
+                    label = dstU[x + 1];
+                    if (a) label = eq.merge(label, dstU[x - 1]);
+                    else if (d) label = eq.merge(label, dst[x - 1]);
+                } else if (a) {
+                    label = dstU[x - 1];
+                } else if (d) {
+                    label = dst[x - 1];
+                } else {
+                    label = eq.newLabel();
+                }
+            }
+            dst[x] = label;
+        }
+    }
+    eq.flatten();
+
+    // 根即最早分配的临时标签，按升序编号恰好是块内首像素的光栅顺序；
+    // 非根标签的 parent 已指向根，就地改写为根的局部编号
+    vector<int>& local = eq.parent;
+    int numFragments = 0;
+    for (int l = 1; l < eq.size(); ++l) local[l] = local[l] == l ? ++numFragments : local[local[l]];
+    tile.fragments.assign((size_t)numFragments + 1, Fragment());
+    tile.overlaps.clear();
+
+    const int cols = binary.cols;
+    for (int y = y0; y < y1; ++y) {
+        int* dst = m_local.ptr<int>(y);
+        const int* prevId = m_labels.ptr<int>(y);
+        int x = x0;
+        while (x < x1) {
+            if (!dst[x]) {
+                ++x;
+                continue;
+            }
+            // 同一局部标签、同一旧编号的一段
+            const int label = local[dst[x]], id = prevId[x];
+            const int start = x;
+            Fragment& f = tile.fragments[label];
+            if (!f.rec.area) f.first = y * cols + x;
+            while (x < x1 && dst[x] && local[dst[x]] == label && prevId[x] == id) {
+                dst[x] = label;
+                f.perimeter += ComponentStats::exposedEdges(binary, y, x);
+                ++x;
+            }
+            f.rec.addRun(y, start, x);
+            if (id) tile.overlaps.push_back({label, id, x - start});
+        }
+    }
+
+    // 合并同一 (局部标签, 旧编号) 的重叠计数
+    auto& ov = tile.overlaps;
+    sort(ov.begin(), ov.end(), [](const Overlap& a, const Overlap& b) { return a.local != b.local ? a.local < b.local : a.id < b.id; });
+    size_t n = 0;
+    for (size_t i = 0; i < ov.size(); ++i) {
+        if (n && ov[n - 1].local == ov[i].local && ov[n - 1].id == ov[i].id) ov[n - 1].count += ov[i].count;
+        else ov[n++] = ov[i];
+    }
+    ov.resize(n);
+}
+
+// 重建本块与右、下、右下、左下邻块之间的碎片邻接（去重）
+void ConnectedComponentsIncremental::linkTile(const Mat& binary, Tile& tile) {
+    const int x0 = tile.rect.x, x1 = tile.rect.x + tile.rect.width - 1;
+    const int y0 = tile.rect.y, y1 = tile.rect.y + tile.rect.height - 1;
+    for (auto& l : tile.links) l.clear();
+    auto link = [&](int dir, int ya, int xa, int yb, int xb) {
+        if (binary.ptr<uchar>(ya)[xa] == 255 && binary.ptr<uchar>(yb)[xb] == 255)
+            tile.links[dir].emplace_back(m_local.ptr<int>(ya)[xa], m_local.ptr<int>(yb)[xb]);
+    };
+
+    if (neighbor(tile, kRight)) {
+        for (int y = y0; y <= y1; ++y) {
+            link(kRight, y, x1, y, x1 + 1);
+            if (m_useEightConnectivity) {
+                if (y > y0) link(kRight, y, x1, y - 1, x1 + 1);
+                if (y < y1) link(kRight, y, x1, y + 1, x1 + 1);
+            }
+        }
+    }
+    if (neighbor(tile, kDown)) {
+        for (int x = x0; x <= x1; ++x) {
+            link(kDown, y1, x, y1 + 1, x);
+            if (m_useEightConnectivity) {
+                if (x > x0) link(kDown, y1, x, y1 + 1, x - 1);
+                if (x < x1) link(kDown, y1, x, y1 + 1, x + 1);
+            }
+        }
+    }
+    if (m_useEightConnectivity) {
+        if (neighbor(tile, kDownRight)) link(kDownRight, y1, x1, y1 + 1, x1 + 1);
+        if (neighbor(tile, kDownLeft)) link(kDownLeft, y1, x0, y1 + 1, x0 - 1);
+    }
+    for (auto& l : tile.links) {
+        sort(l.begin(), l.end());
+        l.erase(unique(l.begin(), l.end()), l.end());
+    }
+}
+
+Mat ConnectedComponentsIncremental::detect(const Mat& binary, int minSize) {
+    Mat labels;
+    detectInto(binary, labels, minSize);
+    return labels;
+}
+
+void ConnectedComponentsIncremental::detectInto(const Mat& binary, Mat& labels, int minSize, ComponentStats* stats, bool withPerimeter) {
+    if (binary.empty() || binary.type() != CV_8UC1) {
+        cerr << "输入必须为单通道二值图像" << endl;
+        labels = Mat();
+        return;
+    }
+    CC_PHASES();
+    CC_PHASE("diff");
+    DetectorWorkspace& ws = workspace();
+    const int rows = binary.rows, cols = binary.cols;
+
+    // 首帧或尺寸改变：全部块都需要标记，没有可继承的编号
+    if (!m_valid || m_prev.rows != rows || m_prev.cols != cols) {
+        initTiles(rows, cols);
+        ws.prepare(m_prev, rows, cols, CV_8UC1);
+        ws.prepare(m_local, rows, cols, CV_32S);
+        ws.prepare(m_labels, rows, cols, CV_32S);
+        m_labels.setTo(Scalar(0));
+        m_maxLabel = 0;
+        for (auto& tile : m_tiles) tile.dirty = true;
+    } else {
+        for (auto& tile : m_tiles) tile.dirty = tileChanged(binary, tile);
+    }
+
+    vector<int>& dirtyList = ws.get<vector<int>>(kDirtyList);
+    ws.reserve(dirtyList, m_tiles.size());
+    dirtyList.clear();
+    for (int t = 0; t < (int)m_tiles.size(); ++t)
+        if (m_tiles[t].dirty) dirtyList.push_back(t);
+    m_dirtyTiles = (int)dirtyList.size();
+
+    // 阶段 1：变化的块各自重新局部标记（块之间互不重叠，可并行），随后重建涉及变化块的边界邻接
+    // 块内缓冲区在并行标记时扩容，前后比较总容量后统一记入工作区的分配计数
+    auto capacityBytes = [&]() {
+        size_t bytes = 0;
+        for (const auto& tile : m_tiles) {
+            bytes += tile.equiv.parent.capacity() * sizeof(int) + tile.fragments.capacity() * sizeof(Fragment) +
+                     tile.overlaps.capacity() * sizeof(Overlap);
+            for (const auto& l : tile.links) bytes += l.capacity() * sizeof(pair<int, int>);
+        }
+        return bytes;
+    };
+    CC_PHASE("tiles");
+    const size_t bytesBefore = capacityBytes();
+    parallel_for_(Range(0, (int)dirtyList.size()), [&](const Range& range) {
+        for (int i = range.start; i < range.end; ++i) {
+            Tile& tile = m_tiles[dirtyList[i]];
+            if (m_useEightConnectivity) relabelTile<true>(binary, tile);
+            else relabelTile<false>(binary, tile);
+        }
+    });
+    // 邻接由上/左侧的块保存，因此左、上、左上、右上邻块变化时同样要重建
+    parallel_for_(Range(0, (int)m_tiles.size()), [&](const Range& range) {
+        for (int t = range.start; t < range.end; ++t) {
+            Tile& tile = m_tiles[t];
+            bool stale = tile.dirty;
+            for (int dir = 0; dir < kNumLinks && !stale; ++dir) {
+                const Tile* nb = neighbor(tile, dir);
+                stale = nb && nb->dirty;
+            }
+            if (stale) linkTile(binary, tile);
+        }
+    });
+    const size_t bytesAfter = capacityBytes();
+    if (bytesAfter > bytesBefore) ws.noteAllocation(bytesAfter - bytesBefore);
+    for (int t : dirtyList) {
+        CC_COUNT(kProvisionalLabels, m_tiles[t].equiv.size() - 1);
+        CC_FLUSH(m_tiles[t].equiv.counters);
+        const Rect& r = m_tiles[t].rect;
+        Mat prevTile = m_prev(r);
+        binary(r).copyTo(prevTile);
+    }
+
+    // 阶段 2：碎片图上的并查集
+    CC_PHASE("graph");
+    int numNodes = 0;
+    for (auto& tile : m_tiles) {
+        tile.nodeOffset = numNodes - 1;
+        numNodes += (int)tile.fragments.size() - 1;
+    }
+    vector<int>& parent = ws.get<vector<int>>(kParent);
+    ws.reserve(parent, (size_t)numNodes);
+    parent.resize(numNodes);
+    for (int i = 0; i < numNodes; ++i) parent[i] = i;
+    for (const auto& tile : m_tiles) {
+        for (int dir = 0; dir < kNumLinks; ++dir) {
+            const Tile* nb = neighbor(tile, dir);
+            if (!nb) continue;
+            for (const auto& l : tile.links[dir]) uniteNodes(parent, tile.nodeOffset + l.first, nb->nodeOffset + l.second);
+        }
+    }
+
+    // 碎片统计量累加到根上
+    vector<Fragment>& roots = ws.get<vector<Fragment>>(kRoots);
+    ws.reserve(roots, (size_t)numNodes);
+    roots.assign((size_t)numNodes, Fragment());
+    for (const auto& tile : m_tiles) {
+        for (int l = 1; l < (int)tile.fragments.size(); ++l) {
+            const Fragment& f = tile.fragments[l];
+            Fragment& r = roots[findNode(parent, tile.nodeOffset + l)];
+            if (!r.rec.area || f.first < r.first) r.first = f.first;
+            r.rec.merge(f.rec);
+            r.perimeter += f.perimeter;
+        }
+    }
+
+    // parent[i] <= i 恒成立，升序一遍即可让每个碎片直接指向根，之后可以并发只读
+    for (int i = 0; i < numNodes; ++i) parent[i] = parent[parent[i]];
+
+    CC_PHASE("ids");
+    // 阶段 3：继承编号。候选为 (根, 旧编号, 重叠像素数)，根存放在 Overlap::local 中：
+    // 未变化块的碎片整体沿用旧编号，变化块取重新标记时统计的重叠
+    vector<Overlap>& candidates = ws.get<vector<Overlap>>(kCandidates);
+    const size_t candidateCapacity = candidates.capacity();
+    candidates.clear();
+    for (const auto& tile : m_tiles) {
+        if (tile.dirty) {
+            for (const auto& o : tile.overlaps) candidates.push_back({findNode(parent, tile.nodeOffset + o.local), o.id, o.count});
+        } else {
+            for (int l = 1; l < (int)tile.fragments.size(); ++l) {
+                const Fragment& f = tile.fragments[l];
+                if (f.id) candidates.push_back({findNode(parent, tile.nodeOffset + l), f.id, f.rec.area});
+            }
+        }
+    }
+    ws.noteGrowth(candidates, candidateCapacity);
+    sort(candidates.begin(), candidates.end(), [](const Overlap& a, const Overlap& b) {
+        return a.local != b.local ? a.local < b.local : a.id < b.id;
+    });
+    size_t n = 0;
+    for (size_t i = 0; i < candidates.size(); ++i) {
+        if (n && candidates[n - 1].local == candidates[i].local && candidates[n - 1].id == candidates[i].id)
+            candidates[n - 1].count += candidates[i].count;
+        else candidates[n++] = candidates[i];
+    }
+    candidates.resize(n);
+    // 重叠多者优先；同等重叠时取较小的旧编号，保证结果确定
+    sort(candidates.begin(), candidates.end(), [](const Overlap& a, const Overlap& b) {
+        if (a.count != b.count) return a.count > b.count;
+        return a.id != b.id ? a.id < b.id : a.local < b.local;
+    });
+
+    vector<int>& rootId = ws.get<vector<int>>(kRootId);
+    ws.assign(rootId, (size_t)numNodes, 0);
+    vector<uchar>& claimed = ws.get<vector<uchar>>(kClaimed);
+    ws.assign(claimed, (size_t)m_maxLabel + numNodes + 2, (uchar)0);
+    for (const auto& c : candidates) {
+        if (rootId[c.local] || claimed[c.id]) continue;
+        rootId[c.local] = c.id;
+        claimed[c.id] = 1;
+    }
+
+    // 没有继承到编号的根按首像素光栅顺序依次取最小的未用编号
+    vector<int>& order = ws.get<vector<int>>(kOrder);
+    ws.reserve(order, (size_t)numNodes);
+    order.clear();
+    for (int i = 0; i < numNodes; ++i)
+        if (parent[i] == i && !rootId[i]) order.push_back(i);
+    sort(order.begin(), order.end(), [&](int a, int b) { return roots[a].first < roots[b].first; });
+    int nextFree = 1;
+    for (int r : order) {
+        while (claimed[nextFree]) ++nextFree;
+        rootId[r] = nextFree;
+        claimed[nextFree] = 1;
+    }
+
+    CC_PHASE("write");
+    // 阶段 4：把编号写回碎片；编号有变化的块（含全部重新标记的块）重写稳定编号图
+    m_maxLabel = 0;
+    for (int i = 0; i < numNodes; ++i) {
+        if (parent[i] != i) continue;
+        roots[i].id = rootId[i];
+        m_maxLabel = max(m_maxLabel, rootId[i]);
+    }
+    parallel_for_(Range(0, (int)m_tiles.size()), [&](const Range& range) {
+        for (int t = range.start; t < range.end; ++t) {
+            Tile& tile = m_tiles[t];
+            bool changed = tile.dirty;
+            for (int l = 1; l < (int)tile.fragments.size(); ++l) {
+                const int id = rootId[parent[tile.nodeOffset + l]];
+                changed |= id != tile.fragments[l].id;
+                tile.fragments[l].id = id;
+            }
+            if (!changed) continue;
+            for (int y = tile.rect.y; y < tile.rect.y + tile.rect.height; ++y) {
+                const int* src = m_local.ptr<int>(y);
+                int* dst = m_labels.ptr<int>(y);
+                for (int x = tile.rect.x; x < tile.rect.x + tile.rect.width; ++x) dst[x] = src[x] ? tile.fragments[src[x]].id : 0;
+            }
+        }
+    });
+    m_valid = true;
+
+    CC_PHASE("output");
+    // 输出：按 minSize 过滤并按需转为 CV_16U；统计表按稳定编号索引
+    const bool filter = minSize > 1;
+    m_numComponents = 0;
+    if (stats) stats->reset(m_maxLabel, withPerimeter);
+    for (int i = 0; i < numNodes; ++i) {
+        if (parent[i] != i || (filter && roots[i].rec.area < minSize)) continue;
+        ++m_numComponents;
+        if (!stats) continue;
+        const Fragment& r = roots[i];
+        const int id = r.id;
+        stats->area[id] = r.rec.area;
+        stats->left[id] = r.rec.left;
+        stats->top[id] = r.rec.top;
+        stats->right[id] = r.rec.right;
+        stats->bottom[id] = r.rec.bottom;
+        stats->m10[id] = r.rec.m10;
+        stats->m01[id] = r.rec.m01;
+        if (withPerimeter) stats->perimeter[id] = r.perimeter;
+    }
+    if (stats) stats->finalize();
+
+    const int depth = outputDepth(m_maxLabel);
+    ws.prepare(labels, rows, cols, depth);
+    if (!filter && depth == CV_32S) {
+        m_labels.copyTo(labels);
+        return;
+    }
+    // 编号 -> 输出值的查找表，被过滤的编号映射为 0
+    vector<int>& lut = ws.get<vector<int>>(kLut);
+    ws.assign(lut, (size_t)m_maxLabel + 1, 0);
+    for (int i = 0; i < numNodes; ++i)
+        if (parent[i] == i && (!filter || roots[i].rec.area >= minSize)) lut[roots[i].id] = roots[i].id;
+    LabelingKernels::dispatchLabelType(depth, [&](auto tag) {
+        using LabelT = typename decltype(tag)::type;
+        parallel_for_(Range(0, rows), [&](const Range& range) {
+            for (int y = range.start; y < range.end; ++y) {
+                const int* src = m_labels.ptr<int>(y);
+                LabelT* dst = labels.ptr<LabelT>(y);
+                for (int x = 0; x < cols; ++x) dst[x] = (LabelT)lut[src[x]];
+            }
+        });
+    });
+}
@@ -0,0 +1,92 @@
+﻿#pragma once
+#include "IComponentDetector.h"
+#include "LabelEquivalence.h"
+#include <utility>
+#include <vector>
+
+// 面向视频流（固定机位、帧间变化很小）的有状态增量标记。
+// 图像划分为 tileSize x tileSize 的块，每块独立做局部标记，保存各局部连通域（碎片）的统计量，
+// 以及与相邻块在边界上的碎片邻接关系。新的一帧到来时：
+// 1. 逐块与上一帧比较（含 1 像素外圈，保证块边缘像素的周长同样正确），只有变化的块重新局部标记、
+//    重建与邻块的边界邻接；
+// 2. 在碎片图上用并查集合并出全局连通域，统计量由碎片直接累加，开销与碎片数而非像素数成正比；
+// 3. 按与上一帧的重叠像素数贪心继承编号：持续存在的连通域保持原编号；分裂时重叠最多的一块继承，
+//    合并时继承重叠最多的旧编号；新出现的连通域按首像素的光栅顺序取最小的未用编号。
+// 连通域划分与统计量和整幅重新标记完全一致，但标签值是稳定编号而非光栅顺序，可能不连续：
+// 取值范围为 [1, maxLabel()]，统计表按编号索引，未使用的编号面积为 0。
+// 首帧（以及尺寸、邻域、块大小改变后）的编号与 ConnectedComponentsUF 相同。
+class ConnectedComponentsIncremental : public IComponentDetector {
+public:
+    cv::Mat detect(const cv::Mat& binary, int minSize = 0) override;
+    std::string name() const override { return m_useEightConnectivity ? "Incremental Tiles (8)" : "Incremental Tiles (4)"; }
+    // 本帧保留（未被 minSize 过滤）的连通域个数
+    int numComponents() const override { return m_numComponents; }
+    void detectInto(const cv::Mat& binary, cv::Mat& labels, int minSize = 0,
+                    ComponentStats* stats = nullptr, bool withPerimeter = false) override;
+
+    // 选择4邻域或8邻域，默认4邻域；改变时清空历史
+    void setEightConnectivity(bool enabled);
+    // 块边长，默认 64；改变时清空历史
+    void setTileSize(int tileSize);
+    // 清空历史，下一帧完整标记并重新从 1 编号
+    void reset();
+
+    // 本帧使用的最大编号（含被 minSize 过滤的连通域）
+    int maxLabel() const { return m_maxLabel; }
+    // 内部的稳定编号标记图（CV_32S，未做 minSize 过滤），下一次调用前有效，可避免一次整幅拷贝
+    const cv::Mat& labels() const { return m_labels; }
+    // 本帧重新标记的块数与总块数
+    int dirtyTiles() const { return m_dirtyTiles; }
+    int numTiles() const { return (int)m_tiles.size(); }
+
+private:
+    // 工作区中的缓冲区编号
+    enum { kParent, kRoots, kCandidates, kRootId, kClaimed, kOrder, kDirtyList, kLut };
+
+    // 块内的局部连通域；全局合并时也用作根的累加器
+    struct Fragment {
+        ComponentRecord rec;
+        int perimeter = 0;
+        int first = 0;  // 首个像素的光栅下标 y * cols + x
+        int id = 0;     // 所属全局连通域的稳定编号
+    };
+
+    // 重新标记的块中，局部连通域与上一帧编号的重叠像素数
+    struct Overlap {
+        int local, id, count;
+    };
+
+    // 与右、下、右下、左下邻块的边界邻接
+    enum { kRight, kDown, kDownRight, kDownLeft, kNumLinks };
+
+    struct Tile {
+        cv::Rect rect;
+        int tx = 0, ty = 0;
+        bool dirty = true;
+        int nodeOffset = 0;                            // 本块碎片在全局碎片图中的起始下标
+        std::vector<Fragment> fragments;               // 以局部标签为下标，0 不用
+        std::vector<Overlap> overlaps;
+        std::vector<std::pair<int, int>> links[kNumLinks];  // (本块局部标签, 邻块局部标签)
+        LabelEquivalence equiv;
+    };
+
+    void initTiles(int rows, int cols);
+    bool tileChanged(const cv::Mat& binary, const Tile& tile) const;
+    template <bool Eight>
+    void relabelTile(const cv::Mat& binary, Tile& tile);
+    void linkTile(const cv::Mat& binary, Tile& tile);
+    const Tile* neighbor(const Tile& tile, int dir) const;
+
+    std::vector<Tile> m_tiles;
+    int m_tilesX = 0, m_tilesY = 0;
+    cv::Mat m_prev;    // 上一帧二值图
+    cv::Mat m_local;   // 块内局部标签（CV_32S）
+    cv::Mat m_labels;  // 稳定编号（CV_32S）
+    bool m_valid = false;
+
+    int m_tileSize = 64;
+    int m_numComponents = 0;
+    int m_maxLabel = 0;
+    int m_dirtyTiles = 0;
+    bool m_useEightConnectivity = false;
+};
@@ -0,0 +1,285 @@
+﻿#include "ConnectedComponentsParallel.h"
+#include "LabelingKernels.h"
+#include <iostream>
+
+using namespace cv;
+using namespace std;
+
+void ConnectedComponentsParallel::setNumThreads(int numThreads) {
+    m_pool.reset(new ThreadPool(numThreads));
+}
+
+// 无锁查找：路径减半，CAS 失败只意味着别的线程已经改写，直接继续即可
+int ConnectedComponentsParallel::findRoot(int x) {
+    for (;;) {
+        int p = m_parent[x].load(memory_order_acquire);
+        if (p == x) return x;
+        int gp = m_parent[p].load(memory_order_acquire);
+        if (gp != p) m_parent[x].compare_exchange_weak(p, gp, memory_order_release, memory_order_relaxed);
+        x = gp;
+    }
+}
+
+// 无锁合并：总是把较大的根挂到较小的根下，保证 parent[x] <= x，根即为光栅顺序最早的标签。
+// 返回是否真的合并了两个集合
+bool ConnectedComponentsParallel::unite(int a, int b) {
+    for (;;) {
+        a = findRoot(a);
+        b = findRoot(b);
+        if (a == b) return false;
+        if (a > b) swap(a, b);
+        int expected = b;
+        if (m_parent[b].compare_exchange_strong(expected, a, memory_order_acq_rel)) return true;
+    }
+}
+
+// 条带内的逐像素决策树扫描；条带首行视为图像上边界
+template <bool Eight, bool Filter>
+void ConnectedComponentsParallel::scanStrip(const Mat& binary, Mat& labels, Strip& strip) {
+    const int cols = binary.cols;
+    LabelEquivalence& eq = strip.equiv;
+    vector<int>& area = strip.area;
+    eq.reset();
+    area.assign(1, 0);
+
+    for (int y = strip.y0; y < strip.y1; ++y) {
+        const uchar* src = binary.ptr<uchar>(y);
+        const uchar* srcU = y > strip.y0 ? binary.ptr<uchar>(y - 1) : nullptr;
+        int* dst = labels.ptr<int>(y);
+        const int* dstU = y > strip.y0 ? labels.ptr<int>(y - 1) : nullptr;
+
+        for (int x = 0; x < cols; ++x) {
+            if (src[x] != 255) {
+                dst[x] = 0;
+                continue;
+            }
+            const bool d = x > 0 && src[x - 1] == 255;  // 左
+            int label;
+            if constexpr (!Eight) {
+                const bool b = srcU && srcU[x] == 255;  // 上
+                if (b) {
+                    label = dstU[x];
+                    if (d && srcU[x - 1] != 255) label = eq.merge(label, dst[x - 1]);
+                } else if (d) {
+                    label = dst[x - 1];
+                } else {
+                    label = eq.newLabel();
+                    if constexpr (Filter) area.push_back(0);
+                }
+            } else {
+                //  a b c
+                //  d x
+                const bool a = srcU && x > 0 && srcU[x - 1] == 255;
+                const bool b = srcU && srcU[x] == 255;
+                const bool c = srcU && x + 1 < cols && srcU[x + 1] == 255;
+                if (b) {
+                    label = dstU[x];
+                } else if (c) {
+                    label = dstU[x + 1];
+                    if (a) label = eq.merge(label, dstU[x - 1]);
+                    else if (d) label = eq.merge(label, dst[x - 1]);
+                } else if (a) {
+                    label = dstU[x - 1];
+                } else if (d) {
+                    label = dst[x - 1];
+                } else {
+                    label = eq.newLabel();
+                    if constexpr (Filter) area.push_back(0);
+                }
+            }
+            dst[x] = label;
+            if constexpr (Filter) area[label]++;
+        }
+    }
+    eq.flatten();
+}
+
+// 条带内的临时标签经全局并查集与最终编号表写入 LabelT 类型的输出；prov 与 labels 可以是同一矩阵
+template <typename LabelT>
+void ConnectedComponentsParallel::relabelStrip(const Mat& binary, const Mat& prov, Mat& labels, const Strip& strip,
+                                               ComponentStats* part, bool withPerimeter) {
+    for (int y = strip.y0; y < strip.y1; ++y) {
+        const int* src = prov.ptr<int>(y);
+        LabelT* dst = labels.ptr<LabelT>(y);
+        for (int x = 0; x < prov.cols; ++x) {
+            int label = src[x];
+            if (label) label = m_finalLabel[m_parent[strip.offset + label].load(memory_order_relaxed)];
+            dst[x] = (LabelT)label;
+            if (part && label) {
+                part->addPixel(label, x, y);
+                if (withPerimeter) part->perimeter[label] += ComponentStats::exposedEdges(binary, y, x);
+            }
+        }
+    }
+}
+
+void ConnectedComponentsParallel::mergeBorder(const Mat& binary, const Mat& labels, const Strip& upper, const Strip& lower) {
+    const int cols = binary.cols;
+    const int yu = upper.y1 - 1, yl = lower.y0;
+    const uchar* srcU = binary.ptr<uchar>(yu);
+    const uchar* src = binary.ptr<uchar>(yl);
+    const int* lblU = labels.ptr<int>(yu);
+    const int* lbl = labels.ptr<int>(yl);
+    CC_INSTR(int64_t unions = 0;)
+    auto link = [&](int a, int b) {
+        if (unite(a, b)) {
+            CC_INSTR(++unions;)
+        }
+    };
+
+    for (int x = 0; x < cols; ++x) {
+        if (src[x] != 255) continue;
+        const int g = lower.offset + lbl[x];
+        if (srcU[x] == 255) {
+            // 正上方已连通时，左上/右上与其同处上一行的同一段，无需重复合并
+            link(g, upper.offset + lblU[x]);
+        } else if (m_useEightConnectivity) {
+            if (x > 0 && srcU[x - 1] == 255) link(g, upper.offset + lblU[x - 1]);
+            if (x + 1 < cols && srcU[x + 1] == 255) link(g, upper.offset + lblU[x + 1]);
+        }
+    }
+    CC_COUNT(kUnions, unions);
+}
+
+Mat ConnectedComponentsParallel::detect(const Mat& binary, int minSize) {
+    Mat labels;
+    detectInto(binary, labels, minSize);
+    return labels;
+}
+
+void ConnectedComponentsParallel::detectInto(const Mat& binary, Mat& labels, int minSize, ComponentStats* stats, bool withPerimeter) {
+    if (binary.empty() || binary.type() != CV_8UC1) {
+        cerr << "输入必须为单通道二值图像" << endl;
+        labels = Mat();
+        return;
+    }
+    if (!m_pool) setNumThreads(0);
+    CC_PHASES();
+    CC_PHASE("scan");
+
+    // 条带缓冲区与全局并查集都是成员，跨调用保留；扩容计入工作区计数
+    DetectorWorkspace& ws = workspace();
+    const int rows = binary.rows;
+    const bool filter = minSize > 1;
+    // 临时标签写在 CV_32S 矩阵上：输出为 CV_32S 时就是输出本身，否则用工作区里的临时矩阵
+    const bool inPlace = labelDepth() == CV_32S;
+    Mat& prov = inPlace ? labels : ws.get<Mat>(kProvisional);
+    ws.prepare(prov, rows, binary.cols, CV_32S);
+
+    // 划分条带
+    const int numStrips = min(rows, m_pool->size());
+    if ((size_t)numStrips > m_strips.size()) ws.noteAllocation((numStrips - m_strips.size()) * sizeof(Strip));
+    m_strips.resize(numStrips);
+    for (int s = 0; s < numStrips; ++s) {
+        m_strips[s].y0 = (int)((int64)rows * s / numStrips);
+        m_strips[s].y1 = (int)((int64)rows * (s + 1) / numStrips);
+    }
+
+    // 阶段 1：各条带独立扫描（扫描时并发 push_back，扫描后再统一检查是否扩容）
+    vector<size_t>& capacity = ws.get<vector<size_t>>(kCapacitySnapshot);
+    ws.assign(capacity, 2 * (size_t)numStrips, (size_t)0);
+    for (int s = 0; s < numStrips; ++s) {
+        capacity[2 * s] = m_strips[s].equiv.parent.capacity();
+        capacity[2 * s + 1] = m_strips[s].area.capacity();
+    }
+    LabelingKernels::dispatch(m_useEightConnectivity, filter, [&](auto eightTag, auto filterTag) {
+        m_pool->parallelFor(numStrips, [&](int s) {
+            scanStrip<decltype(eightTag)::value, decltype(filterTag)::value>(binary, prov, m_strips[s]);
+        });
+    });
+    for (int s = 0; s < numStrips; ++s) {
+        ws.noteGrowth(m_strips[s].equiv.parent, capacity[2 * s]);
+        ws.noteGrowth(m_strips[s].area, capacity[2 * s + 1]);
+        CC_COUNT(kProvisionalLabels, m_strips[s].equiv.size() - 1);
+        CC_FLUSH(m_strips[s].equiv.counters);
+    }
+
+    // 局部标签区间拼接成全局标签空间（0 为背景）
+    int total = 1;
+    for (auto& strip : m_strips) {
+        strip.offset = total - 1;
+        total += strip.equiv.size() - 1;
+    }
+    if ((size_t)total > m_capacity) {
+        m_capacity = (size_t)total;
+        m_parent.reset(new atomic<int>[m_capacity]);
+        m_rootArea.reset(new atomic<int>[m_capacity]);
+        ws.noteAllocation(2 * m_capacity * sizeof(atomic<int>));
+    }
+    ws.assign(m_finalLabel, (size_t)total, 0);
+    m_parent[0].store(0, memory_order_relaxed);
+
+    // 阶段 2：以条带内的根初始化全局并查集
+    CC_PHASE("merge");
+    m_pool->parallelFor(numStrips, [&](int s) {
+        const Strip& strip = m_strips[s];
+        for (int l = 1; l < strip.equiv.size(); ++l) {
+            m_parent[strip.offset + l].store(strip.offset + strip.equiv.parent[l], memory_order_relaxed);
+            m_rootArea[strip.offset + l].store(0, memory_order_relaxed);
+        }
+    });
+
+    // 阶段 3：并行合并条带边界
+    m_pool->parallelFor(numStrips - 1, [&](int s) { mergeBorder(binary, prov, m_strips[s], m_strips[s + 1]); });
+
+    // 阶段 4：压平并查集，需要过滤时把面积累加到根
+    CC_PHASE("resolve");
+    m_pool->parallelFor(numStrips, [&](int s) {
+        const Strip& strip = m_strips[s];
+        for (int l = 1; l < strip.equiv.size(); ++l) {
+            const int g = strip.offset + l;
+            const int r = findRoot(g);
+            m_parent[g].store(r, memory_order_relaxed);
+            if (filter && strip.area[l]) m_rootArea[r].fetch_add(strip.area[l], memory_order_relaxed);
+        }
+    });
+
+    // 阶段 5：统计每个条带区间内保留的根数，前缀和后按根升序编号
+    auto keep = [&](int g) {
+        return m_parent[g].load(memory_order_relaxed) == g && (!filter || m_rootArea[g].load(memory_order_relaxed) >= minSize);
+    };
+    vector<int>& kept = m_kept;
+    ws.assign(kept, (size_t)numStrips + 1, 0);
+    m_pool->parallelFor(numStrips, [&](int s) {
+        const Strip& strip = m_strips[s];
+        int n = 0;
+        for (int l = 1; l < strip.equiv.size(); ++l) {
+            const int g = strip.offset + l;
+            if (keep(g)) ++n;
+        }
+        kept[s + 1] = n;
+    });
+    for (int s = 0; s < numStrips; ++s) kept[s + 1] += kept[s];
+
+    m_pool->parallelFor(numStrips, [&](int s) {
+        const Strip& strip = m_strips[s];
+        int next = kept[s];
+        for (int l = 1; l < strip.equiv.size(); ++l) {
+            const int g = strip.offset + l;
+            if (keep(g)) m_finalLabel[g] = ++next;
+        }
+    });
+
+    // 阶段 6：并行重写标签图，需要时各条带累加部分统计量，最后归并
+    CC_PHASE("relabel");
+    const int numKept = kept[numStrips];
+    const int depth = outputDepth(numKept);
+    if (!inPlace) ws.prepare(labels, rows, binary.cols, depth);
+    LabelingKernels::dispatchLabelType(depth, [&](auto tag) {
+        m_pool->parallelFor(numStrips, [&](int s) {
+            Strip& strip = m_strips[s];
+            ComponentStats* part = nullptr;
+            if (stats) {
+                part = s == 0 ? stats : &strip.stats;
+                part->reset(numKept, withPerimeter);
+            }
+            relabelStrip<typename decltype(tag)::type>(binary, prov, labels, strip, part, withPerimeter);
+        });
+    });
+    if (stats) {
+        for (int s = 1; s < numStrips; ++s) stats->merge(m_strips[s].stats);
+        stats->finalize();
+    }
+
+    m_numComponents = numKept;
+}
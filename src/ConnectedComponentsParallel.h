@@ -0,0 +1,61 @@
+﻿#pragma once
+#include "IComponentDetector.h"
+#include "LabelEquivalence.h"
+#include "ThreadPool.h"
+#include <atomic>
+#include <memory>
+#include <vector>
+
+// 按水平条带并行的连通域标记：
+// 1. 每个条带在线程池上独立扫描，临时标签与等价表均为条带局部；
+// 2. 条带局部标签加上前缀偏移得到全局临时标签，用无锁并查集合并条带边界两侧的等价关系；
+// 3. 并行统计面积、按根标签升序编号（即光栅顺序），再并行重写标签图。
+// 输出与 ConnectedComponentsUF 完全一致。
+class ConnectedComponentsParallel : public IComponentDetector {
+public:
+    cv::Mat detect(const cv::Mat& binary, int minSize = 0) override;
+    std::string name() const override { return m_useEightConnectivity ? "Parallel Custom (8)" : "Parallel Custom (4)"; }
+    int numComponents() const override { return m_numComponents; }
+    void detectInto(const cv::Mat& binary, cv::Mat& labels, int minSize = 0,
+                    ComponentStats* stats = nullptr, bool withPerimeter = false) override;
+
+    // 选择4邻域或8邻域，默认4邻域
+    void setEightConnectivity(bool enabled) { m_useEightConnectivity = enabled; }
+
+    // 线程数，<= 0 表示使用全部硬件线程
+    void setNumThreads(int numThreads);
+    int numThreads() const { return m_pool ? m_pool->size() : 0; }
+
+private:
+    // 工作区中的缓冲区编号
+    enum { kCapacitySnapshot, kProvisional };
+
+    struct Strip {
+        int y0 = 0, y1 = 0;       // 行范围 [y0, y1)
+        int offset = 0;           // 局部标签 -> 全局标签的偏移
+        LabelEquivalence equiv;
+        std::vector<int> area;    // 每个局部临时标签的像素数（仅在需要过滤时统计）
+        ComponentStats stats;     // 重写标签时按条带累加的部分统计量
+    };
+
+    template <bool Eight, bool Filter>
+    static void scanStrip(const cv::Mat& binary, cv::Mat& labels, Strip& strip);
+    template <typename LabelT>
+    void relabelStrip(const cv::Mat& binary, const cv::Mat& prov, cv::Mat& labels, const Strip& strip,
+                      ComponentStats* part, bool withPerimeter);
+    void mergeBorder(const cv::Mat& binary, const cv::Mat& labels, const Strip& upper, const Strip& lower);
+
+    int findRoot(int x);
+    bool unite(int a, int b);
+
+    std::unique_ptr<ThreadPool> m_pool;
+    std::vector<Strip> m_strips;
+    std::unique_ptr<std::atomic<int>[]> m_parent;  // 全局临时标签的无锁并查集
+    std::unique_ptr<std::atomic<int>[]> m_rootArea;
+    std::vector<int> m_finalLabel;
+    std::vector<int> m_kept;                       // 各条带保留根数的前缀和
+    size_t m_capacity = 0;
+
+    int m_numComponents = 0;
+    bool m_useEightConnectivity = false;
+};
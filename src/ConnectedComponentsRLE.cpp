@@ -0,0 +1,219 @@
+﻿#include "ConnectedComponentsRLE.h"
+#include <iostream>
+
+using namespace cv;
+using namespace std;
+
+void ConnectedComponentsRLE::appendRowRuns(const uchar* src, int cols, int y, vector<Run>& runs) {
+    int x = 0;
+    while (x < cols) {
+        while (x < cols && src[x] != 255) ++x;
+        if (x == cols) break;
+        const int start = x;
+        while (x < cols && src[x] == 255) ++x;
+        runs.push_back({y, start, x, 0});
+    }
+}
+
+void ConnectedComponentsRLE::extractRuns(const Mat& binary, RunLengthLabels& rl) {
+    const size_t capacity = rl.runs.capacity();
+    for (int y = 0; y < binary.rows; ++y) {
+        appendRowRuns(binary.ptr<uchar>(y), binary.cols, y, rl.runs);
+        rl.rowStart[y + 1] = (int)rl.runs.size();
+    }
+    workspace().noteGrowth(rl.runs, capacity);
+}
+
+// 行 [k, end) 中的游程覆盖 [x0, x1) 的像素数；k 随 x0 单调前进
+static int coveredLength(const vector<Run>& runs, int& k, int end, int x0, int x1) {
+    while (k < end && runs[k].xEnd <= x0) ++k;
+    int covered = 0;
+    for (int j = k; j < end && runs[j].xStart < x1; ++j)
+        covered += min(x1, runs[j].xEnd) - max(x0, runs[j].xStart);
+    return covered;
+}
+
+void ConnectedComponentsRLE::labelRuns(RunLengthLabels& rl, int minSize, ComponentStats* stats, bool withPerimeter) {
+    // 8 邻域下对角相接也算重叠：把上一行游程左右各扩一个像素
+    const int slack = m_useEightConnectivity ? 1 : 0;
+    vector<Run>& runs = rl.runs;
+    CC_PHASES();
+    CC_PHASE("merge");
+
+    DetectorWorkspace& ws = workspace();
+    LabelEquivalence& eq = ws.get<LabelEquivalence>(kEquivalence);
+    vector<int>& area = ws.get<vector<int>>(kProvArea);
+    vector<int>& finalLabel = ws.get<vector<int>>(kFinalLabel);
+    ws.reserve(eq.parent, runs.size() + 1);
+    ws.reserve(area, runs.size() + 1);
+    eq.reset();
+    area.assign(1, 0);
+
+    // 第一遍：每个游程与上一行重叠的游程合并
+    for (int y = 0; y < rl.rows; ++y) {
+        int j = y > 0 ? rl.rowStart[y - 1] : 0;
+        const int prevEnd = y > 0 ? rl.rowStart[y] : 0;
+
+        for (int i = rl.rowStart[y]; i < rl.rowStart[y + 1]; ++i) {
+            Run& cur = runs[i];
+            // 跳过完全位于当前游程左侧的上一行游程，它们也不会与后续游程重叠
+            while (j < prevEnd && runs[j].xEnd + slack <= cur.xStart) ++j;
+
+            int label = 0;
+            for (int k = j; k < prevEnd && runs[k].xStart < cur.xEnd + slack; ++k) {
+                label = label ? eq.merge(label, runs[k].label) : runs[k].label;
+            }
+            if (!label) {
+                label = eq.newLabel();
+                area.push_back(0);
+            }
+            cur.label = label;
+            area[label] += cur.xEnd - cur.xStart;
+        }
+    }
+
+    CC_COUNT(kProvisionalLabels, eq.size() - 1);
+    CC_FLUSH(eq.counters);
+
+    // 解析等价表；临时标签按光栅顺序分配，根按升序编号即与逐像素扫描的编号一致
+    CC_PHASE("resolve");
+    eq.flatten();
+    const vector<int>& root = eq.parent;
+    for (int l = 1; l < eq.size(); ++l) {
+        if (root[l] != l) area[root[l]] += area[l];
+    }
+    ws.assign(finalLabel, (size_t)eq.size(), 0);
+    int nextLabel = 0;
+    for (int l = 1; l < eq.size(); ++l) {
+        if (root[l] == l && area[l] >= minSize) finalLabel[l] = ++nextLabel;
+    }
+
+    // 第二遍：改写为最终标签，需要时按游程累加统计量。
+    // 周长 = 每段两端的 2 条边 + 上下两行中未被前景覆盖的长度（被过滤的游程仍是前景）
+    CC_PHASE("relabel");
+    if (stats) stats->reset(nextLabel, withPerimeter);
+    bool anyFiltered = false;
+    for (int y = 0; y < rl.rows; ++y) {
+        int up = y > 0 ? rl.rowStart[y - 1] : 0;
+        const int upEnd = y > 0 ? rl.rowStart[y] : 0;
+        int down = rl.rowStart[y + 1];
+        const int downEnd = y + 1 < rl.rows ? rl.rowStart[y + 2] : down;
+
+        for (int i = rl.rowStart[y]; i < rl.rowStart[y + 1]; ++i) {
+            Run& r = runs[i];
+            r.label = finalLabel[root[r.label]];
+            if (!r.label) {
+                anyFiltered = true;
+                continue;
+            }
+            if (!stats) continue;
+            stats->addRun(r.label, y, r.xStart, r.xEnd);
+            if (withPerimeter) {
+                const int len = r.xEnd - r.xStart;
+                stats->perimeter[r.label] += 2 + (len - coveredLength(runs, up, upEnd, r.xStart, r.xEnd))
+                                               + (len - coveredLength(runs, down, downEnd, r.xStart, r.xEnd));
+            }
+        }
+    }
+    if (stats) stats->finalize();
+    rl.numComponents = nextLabel;
+    if (!anyFiltered) return;
+
+    // 移除被过滤的游程
+    size_t out = 0;
+    for (int y = 0; y < rl.rows; ++y) {
+        const int begin = rl.rowStart[y], end = rl.rowStart[y + 1];
+        rl.rowStart[y] = (int)out;
+        for (int i = begin; i < end; ++i) {
+            if (runs[i].label) runs[out++] = runs[i];
+        }
+    }
+    rl.rowStart[rl.rows] = (int)out;
+    runs.resize(out);
+}
+
+const RunLengthLabels& ConnectedComponentsRLE::detectRuns(const Mat& binary, int minSize, ComponentStats* stats, bool withPerimeter) {
+    if (binary.empty() || binary.type() != CV_8UC1) {
+        cerr << "输入必须为单通道二值图像" << endl;
+        m_result.reset(0, 0);
+        return m_result;
+    }
+    CC_PHASES();
+    CC_PHASE("extract");
+    m_result.reset(binary.rows, binary.cols);
+    extractRuns(binary, m_result);
+    CC_PHASE_END();
+    labelRuns(m_result, minSize, stats, withPerimeter);
+    return m_result;
+}
+
+const RunLengthLabels& ConnectedComponentsRLE::detectRuns(const PackedBinaryMask& mask, int minSize, ComponentStats* stats, bool withPerimeter) {
+    m_result.reset(mask.rows(), mask.cols());
+    const size_t capacity = m_result.runs.capacity();
+    for (int y = 0; y < mask.rows(); ++y) {
+        mask.appendRuns(y, m_result.runs);
+        m_result.rowStart[y + 1] = (int)m_result.runs.size();
+    }
+    workspace().noteGrowth(m_result.runs, capacity);
+    labelRuns(m_result, minSize, stats, withPerimeter);
+    return m_result;
+}
+
+const RunLengthLabels& ConnectedComponentsRLE::detectRunsFromGray(const Mat& gray, double thresh, int minSize,
+                                                                  ComponentStats* stats, bool withPerimeter) {
+    if (gray.empty() || gray.type() != CV_8UC1) {
+        cerr << "输入必须为单通道灰度图像" << endl;
+        m_result.reset(0, 0);
+        return m_result;
+    }
+    DetectorWorkspace& ws = workspace();
+    ThresholdClose& frontEnd = ws.get<ThresholdClose>(kFrontEnd);
+    const size_t bufferCapacity = frontEnd.buffer().capacity();
+    const size_t runsCapacity = m_result.runs.capacity();
+
+    m_result.reset(gray.rows, gray.cols);
+    frontEnd.run(gray, thresh, [&](int y, const uchar* row) {
+        appendRowRuns(row, gray.cols, y, m_result.runs);
+        m_result.rowStart[y + 1] = (int)m_result.runs.size();
+    });
+    ws.noteGrowth(frontEnd.buffer(), bufferCapacity);
+    ws.noteGrowth(m_result.runs, runsCapacity);
+
+    labelRuns(m_result, minSize, stats, withPerimeter);
+    return m_result;
+}
+
+Mat ConnectedComponentsRLE::detectFromGray(const Mat& gray, double thresh, int minSize) {
+    const RunLengthLabels& rl = detectRunsFromGray(gray, thresh, minSize);
+    if (rl.rows == 0) return Mat();
+    return rl.toLabelMat(outputDepth(rl.numComponents));
+}
+
+Mat ConnectedComponentsRLE::detect(const PackedBinaryMask& mask, int minSize) {
+    if (mask.empty()) {
+        cerr << "输入掩码为空" << endl;
+        m_result.reset(0, 0);
+        return Mat();
+    }
+    const RunLengthLabels& rl = detectRuns(mask, minSize);
+    return rl.toLabelMat(outputDepth(rl.numComponents));
+}
+
+Mat ConnectedComponentsRLE::detect(const Mat& binary, int minSize) {
+    Mat labels;
+    detectInto(binary, labels, minSize);
+    return labels;
+}
+
+void ConnectedComponentsRLE::detectInto(const Mat& binary, Mat& labels, int minSize, ComponentStats* stats, bool withPerimeter) {
+    const RunLengthLabels& rl = detectRuns(binary, minSize, stats, withPerimeter);
+    if (rl.rows == 0) {
+        labels = Mat();
+        return;
+    }
+    CC_PHASES();
+    CC_PHASE("expand");
+    const int depth = outputDepth(rl.numComponents);
+    workspace().prepare(labels, rl.rows, rl.cols, depth);
+    rl.toLabelMat(labels, depth);
+}
@@ -0,0 +1,51 @@
+﻿#pragma once
+#include "IComponentDetector.h"
+#include "LabelEquivalence.h"
+#include "PackedBinaryMask.h"
+#include "RunLengthLabels.h"
+#include "ThresholdClose.h"
+#include <vector>
+
+// 基于游程（run-length）的连通域标记：
+// 先把每行提取为前景游程，再只在相邻两行的游程之间按重叠关系合并，
+// 标记对象是游程而不是像素，长水平段越多越划算。
+// 结果以 RunLengthLabels 形式保存，需要时再展开为 CV_32S 标记矩阵，编号与 ConnectedComponentsUF 一致。
+class ConnectedComponentsRLE : public IComponentDetector {
+public:
+    cv::Mat detect(const cv::Mat& binary, int minSize = 0) override;
+    std::string name() const override { return m_useEightConnectivity ? "RLE Custom (8)" : "RLE Custom (4)"; }
+    int numComponents() const override { return m_result.numComponents; }
+    void detectInto(const cv::Mat& binary, cv::Mat& labels, int minSize = 0,
+                    ComponentStats* stats = nullptr, bool withPerimeter = false) override;
+
+    // 选择4邻域或8邻域，默认4邻域
+    void setEightConnectivity(bool enabled) { m_useEightConnectivity = enabled; }
+
+    // 只做游程标记，不展开标记矩阵；stats 非空时按游程累加统计量
+    const RunLengthLabels& detectRuns(const cv::Mat& binary, int minSize = 0, ComponentStats* stats = nullptr, bool withPerimeter = false);
+    const RunLengthLabels& runs() const { return m_result; }
+
+    // 直接消费 1 bit/像素的打包掩码，游程由位运算逐字提取
+    cv::Mat detect(const PackedBinaryMask& mask, int minSize = 0);
+    const RunLengthLabels& detectRuns(const PackedBinaryMask& mask, int minSize = 0, ComponentStats* stats = nullptr, bool withPerimeter = false);
+
+    // 融合前端：直接从灰度图逐行做 阈值化 + 3x3 闭运算，每算出一行就提取游程，
+    // 不生成任何整幅中间二值图；结果与 threshold(THRESH_BINARY) + morphologyEx(MORPH_CLOSE) + detect 完全一致
+    cv::Mat detectFromGray(const cv::Mat& gray, double thresh, int minSize = 0);
+    const RunLengthLabels& detectRunsFromGray(const cv::Mat& gray, double thresh, int minSize = 0,
+                                              ComponentStats* stats = nullptr, bool withPerimeter = false);
+
+    // 对已提取好的游程（按光栅顺序、rowStart 已填好）做标记：
+    // 被 minSize 过滤掉的游程会被移除，其余游程的 label 改写为最终标签
+    void labelRuns(RunLengthLabels& rl, int minSize = 0, ComponentStats* stats = nullptr, bool withPerimeter = false);
+
+private:
+    // 工作区中的缓冲区编号
+    enum { kEquivalence, kProvArea, kFinalLabel, kFrontEnd };
+
+    void extractRuns(const cv::Mat& binary, RunLengthLabels& rl);
+    static void appendRowRuns(const uchar* src, int cols, int y, std::vector<Run>& runs);
+
+    RunLengthLabels m_result;
+    bool m_useEightConnectivity = false;
+};
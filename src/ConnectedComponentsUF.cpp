@@ -1,85 +1,139 @@
 ﻿#include "ConnectedComponentsUF.h"
+#include "LabelingKernels.h"
 #include <iostream>
-#include <map>
 
 using namespace cv;
 using namespace std;
 
+template <bool Eight>
+void ConnectedComponentsUF::unionScan(const Mat& binary, UnionFind& uf) {
+    const int rows = binary.rows, cols = binary.cols;
+    // 只向右、下（以及对角）方向合并，避免重复合并
+    for (int y = 0; y < rows; ++y) {
+        const uchar* src = binary.ptr<uchar>(y);
+        const uchar* srcD = y + 1 < rows ? binary.ptr<uchar>(y + 1) : nullptr;
+        const int base = y * cols;
+        for (int x = 0; x < cols; ++x) {
+            if (src[x] != 255) continue;
+            const int i = base + x;
+            // 右
+            if (x + 1 < cols && src[x + 1] == 255) uf.unite(i, i + 1);
+            if (!srcD) continue;
+            // 下
+            if (srcD[x] == 255) uf.unite(i, i + cols);
+            if constexpr (Eight) {
+                // 右下、左下
+                if (x + 1 < cols && srcD[x + 1] == 255) uf.unite(i, i + cols + 1);
+                if (x > 0 && srcD[x - 1] == 255) uf.unite(i, i + cols - 1);
+            }
+        }
+    }
+}
+
+template <typename LabelT, bool Filter>
+int ConnectedComponentsUF::relabel(const Mat& binary, UnionFind& uf, const vector<int>& componentSize, int minSize,
+                                   vector<int>& labelMap, Mat& labels, ComponentStats* stats, bool withPerimeter) {
+    const int cols = binary.cols;
+    int nextLabel = 0;
+    for (int y = 0; y < binary.rows; ++y) {
+        const uchar* src = binary.ptr<uchar>(y);
+        LabelT* dst = labels.ptr<LabelT>(y);
+        const int base = y * cols;
+        for (int x = 0; x < cols; ++x) {
+            int label = 0;
+            if (src[x] == 255) {
+                const int root = uf.find(base + x);
+                bool keep = true;
+                if constexpr (Filter) keep = componentSize[root] >= minSize;
+                if (keep) {
+                    if (labelMap[root] == 0) {
+                        // 分配新标签
+                        labelMap[root] = ++nextLabel;
+                    }
+                    label = labelMap[root];
+                    if (stats) {
+                        stats->addPixel(label, x, y);
+                        if (withPerimeter) stats->perimeter[label] += ComponentStats::exposedEdges(binary, y, x);
+                    }
+                }
+            }
+            dst[x] = (LabelT)label;
+        }
+    }
+    return nextLabel;
+}
+
 cv::Mat ConnectedComponentsUF::detect(const cv::Mat& binary, int minSize) {
+    Mat labels;
+    detectInto(binary, labels, minSize);
+    return labels;
+}
+
+void ConnectedComponentsUF::detectInto(const cv::Mat& binary, cv::Mat& labels, int minSize, ComponentStats* stats, bool withPerimeter) {
     if (binary.empty() || binary.type() != CV_8UC1) {
         cerr << "输入必须为单通道二值图像" << endl;
-        return Mat();
+        labels = Mat();
+        return;
     }
 
+    CC_PHASES();
+    CC_PHASE("init");
     int rows = binary.rows, cols = binary.cols;
     int total = rows * cols;
-    UnionFind uf(total);
+    DetectorWorkspace& ws = workspace();
+    UnionFind& uf = ws.get<UnionFind>(kUnionFind);
+    ws.reserve(uf.parent, total);
+    ws.reserve(uf.size, total);
+    uf.reset(total);
 
-    auto index = [cols](int y, int x) { return y * cols + x; };
+    // 根据邻域类型进行合并
+    CC_PHASE("union");
+    if (m_useEightConnectivity) unionScan<true>(binary, uf);
+    else unionScan<false>(binary, uf);
+    CC_COUNT(kProvisionalLabels, total);
+    CC_FLUSH(uf.counters);
 
-    // 根据邻域类型进行合并：只向右、下（以及对角）方向，避免重复合并
-    if (!m_useEightConnectivity) {
-        // 4 邻域：只合并 (x+1,y) 和 (x,y+1)
+    // 需要过滤时统计每个根的尺寸
+    const bool filter = minSize > 1;
+    vector<int>& componentSize = ws.get<vector<int>>(kComponentSize);
+    if (filter) {
+        CC_PHASE("size");
+        ws.assign(componentSize, total, 0);
         for (int y = 0; y < rows; ++y) {
-            for (int x = 0; x < cols; ++x) {
-                if (binary.at<uchar>(y, x) != 255) continue;
-                if (x + 1 < cols && binary.at<uchar>(y, x + 1) == 255)
-                    uf.unite(index(y, x), index(y, x + 1));
-                if (y + 1 < rows && binary.at<uchar>(y + 1, x) == 255)
-                    uf.unite(index(y, x), index(y + 1, x));
-            }
-        }
-    } else {
-        // 8 邻域：向右、下三个方向 + 两个对角方向 (x+1,y), (x,y+1), (x+1,y+1), (x-1,y+1)
-        for (int y = 0; y < rows; ++y) {
-            for (int x = 0; x < cols; ++x) {
-                if (binary.at<uchar>(y, x) != 255) continue;
-                // 右
-                if (x + 1 < cols && binary.at<uchar>(y, x + 1) == 255)
-                    uf.unite(index(y, x), index(y, x + 1));
-                // 下
-                if (y + 1 < rows && binary.at<uchar>(y + 1, x) == 255)
-                    uf.unite(index(y, x), index(y + 1, x));
-                // 右下
-                if (x + 1 < cols && y + 1 < rows && binary.at<uchar>(y + 1, x + 1) == 255)
-                    uf.unite(index(y, x), index(y + 1, x + 1));
-                // 左下
-                if (x - 1 >= 0 && y + 1 < rows && binary.at<uchar>(y + 1, x - 1) == 255)
-                    uf.unite(index(y, x), index(y + 1, x - 1));
-            }
+            const uchar* src = binary.ptr<uchar>(y);
+            for (int x = 0; x < cols; ++x)
+                if (src[x] == 255) componentSize[uf.find(y * cols + x)]++;
         }
     }
 
-    // 统计每个根的尺寸
-    vector<int> componentSize(total, 0);
-    for (int y = 0; y < rows; ++y) {
-        for (int x = 0; x < cols; ++x) {
-            if (binary.at<uchar>(y, x) == 255) {
-                int root = uf.find(index(y, x));
-                componentSize[root]++;
+    // 统计表与输出深度都需要预先知道保留的连通域个数
+    int kept = 0;
+    if (stats || labelDepth() != CV_32S) {
+        CC_PHASE("count");
+        for (int y = 0; y < rows; ++y) {
+            const uchar* src = binary.ptr<uchar>(y);
+            for (int x = 0; x < cols; ++x) {
+                const int i = y * cols + x;
+                if (src[x] == 255 && uf.parent[i] == i && (!filter || componentSize[i] >= minSize)) ++kept;
             }
         }
     }
+    if (stats) stats->reset(kept, withPerimeter);
 
-    // 给满足 minSize 的根重新映射 label
-    map<int, int> labelMap;
-    Mat labels = Mat::zeros(rows, cols, CV_32S);
+    // 给保留的根重新映射 label（根 -> 新标签的查找表），需要时顺带累加统计量。
+    // 输出矩阵可能是复用的，每个像素都显式写入
+    CC_PHASE("relabel");
+    vector<int>& labelMap = ws.get<vector<int>>(kLabelMap);
+    ws.assign(labelMap, total, 0);
+    const int depth = outputDepth(kept);
+    ws.prepare(labels, rows, cols, depth);
     int nextLabel = 0;
-    for (int y = 0; y < rows; ++y) {
-        for (int x = 0; x < cols; ++x) {
-            if (binary.at<uchar>(y, x) == 255) {
-                int root = uf.find(index(y, x));
-                if (componentSize[root] >= minSize) {
-                    if (labelMap[root] == 0) {
-                        // 分配新标签
-                        labelMap[root] = ++nextLabel;
-                    }
-                    labels.at<int>(y, x) = labelMap[root];
-                }
-            }
-        }
-    }
+    LabelingKernels::dispatchLabelType(depth, [&](auto tag) {
+        using LabelT = typename decltype(tag)::type;
+        nextLabel = filter ? relabel<LabelT, true>(binary, uf, componentSize, minSize, labelMap, labels, stats, withPerimeter)
+                           : relabel<LabelT, false>(binary, uf, componentSize, minSize, labelMap, labels, stats, withPerimeter);
+    });
+    if (stats) stats->finalize();
 
     m_numComponents = nextLabel;
-    return labels;
 }
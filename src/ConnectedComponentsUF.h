@@ -10,18 +10,37 @@ public:
     // 动态名称，指明4/8邻域
     std::string name() const override { return m_useEightConnectivity ? "Union-Find Custom (8)" : "Union-Find Custom (4)"; }
     int numComponents() const override { return m_numComponents; }
+    void detectInto(const cv::Mat& binary, cv::Mat& labels, int minSize = 0,
+                    ComponentStats* stats = nullptr, bool withPerimeter = false) override;
 
     // 选择4邻域或8邻域，默认4邻域
     void setEightConnectivity(bool enabled) { m_useEightConnectivity = enabled; }
 
 private:
+    // 工作区中的缓冲区编号
+    enum { kUnionFind, kComponentSize, kLabelMap };
+
     struct UnionFind {
         std::vector<int> parent, size;
-        explicit UnionFind(int n) : parent(n), size(n, 1) { iota(parent.begin(), parent.end(), 0); }
+        CC_INSTR(Instrumentation::LocalCounters counters;)
+        // 重置为 n 个独立集合；容量足够时不重新分配
+        void reset(int n) {
+            CC_INSTR(counters.clear();)
+            parent.resize(n);
+            iota(parent.begin(), parent.end(), 0);
+            size.assign(n, 1);
+        }
         int find(int x) { return parent[x] == x ? x : parent[x] = find(parent[x]); }
+        CC_INSTR(int depth(int x) const {
+            int d = 0;
+            for (; parent[x] != x; x = parent[x]) ++d;
+            return d;
+        })
         void unite(int a, int b) {
+            CC_INSTR(counters.find(depth(a)); counters.find(depth(b));)
             a = find(a); b = find(b);
             if (a != b) {
+                CC_INSTR(++counters.unions;)
                 if (size[a] < size[b]) std::swap(a, b);
                 parent[b] = a;
                 size[a] += size[b];
@@ -29,6 +48,14 @@ private:
         }
     };
 
+    // 第一遍：按邻域合并相邻前景像素
+    template <bool Eight>
+    static void unionScan(const cv::Mat& binary, UnionFind& uf);
+    // 第二遍：按光栅顺序给保留的根编号并写入 LabelT 类型的输出，返回连通域数
+    template <typename LabelT, bool Filter>
+    static int relabel(const cv::Mat& binary, UnionFind& uf, const std::vector<int>& componentSize, int minSize,
+                       std::vector<int>& labelMap, cv::Mat& labels, ComponentStats* stats, bool withPerimeter);
+
     int m_numComponents = 0;
     bool m_useEightConnectivity = false;
 };
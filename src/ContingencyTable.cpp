@@ -0,0 +1,173 @@
+﻿#include "ContingencyTable.h"
+#include "LabelingKernels.h"
+#include "ThreadPool.h"
+#include <algorithm>
+
+using namespace cv;
+using namespace std;
+
+// 单个行块的局部表：以 (r << 32) | t 为键，行内相同键的连续像素先合并再排序归并
+struct PartialTable {
+    vector<uint64_t> keys;
+    vector<int64_t> counts;
+};
+
+static inline uint64_t packKey(int r, int t) { return ((uint64_t)(uint32_t)r << 32) | (uint32_t)t; }
+
+// 按键排序并合并相同键
+static void sortAndReduce(PartialTable& p) {
+    vector<size_t> order(p.keys.size());
+    for (size_t i = 0; i < order.size(); ++i) order[i] = i;
+    sort(order.begin(), order.end(), [&](size_t a, size_t b) { return p.keys[a] < p.keys[b]; });
+
+    PartialTable out;
+    out.keys.reserve(order.size());
+    out.counts.reserve(order.size());
+    for (size_t i : order) {
+        if (!out.keys.empty() && out.keys.back() == p.keys[i]) out.counts.back() += p.counts[i];
+        else {
+            out.keys.push_back(p.keys[i]);
+            out.counts.push_back(p.counts[i]);
+        }
+    }
+    p = std::move(out);
+}
+
+template <typename RefT, typename TestT>
+static void scanRows(const Mat& refLabels, const Mat& testLabels, int y0, int y1, PartialTable& p) {
+    for (int y = y0; y < y1; ++y) {
+        const RefT* rr = refLabels.ptr<RefT>(y);
+        const TestT* tt = testLabels.ptr<TestT>(y);
+        uint64_t cur = packKey(rr[0], tt[0]);
+        int64_t n = 0;
+        for (int x = 0; x < refLabels.cols; ++x) {
+            const uint64_t key = packKey(rr[x], tt[x]);
+            if (key != cur) {
+                p.keys.push_back(cur);
+                p.counts.push_back(n);
+                cur = key;
+                n = 0;
+            }
+            ++n;
+        }
+        p.keys.push_back(cur);
+        p.counts.push_back(n);
+    }
+    sortAndReduce(p);
+}
+
+static inline double pairs(double n) { return n * (n - 1) / 2; }
+
+ContingencyTable ContingencyTable::build(const Mat& refLabels, const Mat& testLabels, ThreadPool* pool) {
+    CV_Assert(refLabels.size() == testLabels.size());
+    CV_Assert(refLabels.type() == CV_32S || refLabels.type() == CV_16U);
+    CV_Assert(testLabels.type() == CV_32S || testLabels.type() == CV_16U);
+
+    ContingencyTable table;
+    const int rows = refLabels.rows;
+    if (refLabels.empty()) return table;
+
+    // 行块数取线程数的若干倍，块间负载更均衡
+    const int numBlocks = pool ? min(rows, pool->size() * 4) : 1;
+    vector<PartialTable> parts(numBlocks);
+    auto scanBlock = [&](int b) {
+        const int y0 = (int)((int64_t)rows * b / numBlocks), y1 = (int)((int64_t)rows * (b + 1) / numBlocks);
+        LabelingKernels::dispatchLabelType(refLabels.depth(), [&](auto refTag) {
+            LabelingKernels::dispatchLabelType(testLabels.depth(), [&](auto testTag) {
+                scanRows<typename decltype(refTag)::type, typename decltype(testTag)::type>(refLabels, testLabels, y0, y1, parts[b]);
+            });
+        });
+    };
+    if (pool) pool->parallelFor(numBlocks, scanBlock);
+    else scanBlock(0);
+
+    // 归并各行块的局部表
+    PartialTable merged = std::move(parts[0]);
+    for (int b = 1; b < numBlocks; ++b) {
+        merged.keys.insert(merged.keys.end(), parts[b].keys.begin(), parts[b].keys.end());
+        merged.counts.insert(merged.counts.end(), parts[b].counts.begin(), parts[b].counts.end());
+    }
+    if (numBlocks > 1) sortAndReduce(merged);
+
+    int maxRef = 0, maxTest = 0;
+    table.cells.resize(merged.keys.size());
+    for (size_t i = 0; i < merged.keys.size(); ++i) {
+        Cell& c = table.cells[i];
+        c.ref = (int)(merged.keys[i] >> 32);
+        c.test = (int)(uint32_t)merged.keys[i];
+        c.count = merged.counts[i];
+        maxRef = max(maxRef, c.ref);
+        maxTest = max(maxTest, c.test);
+    }
+
+    table.refArea.assign((size_t)maxRef + 1, 0);
+    table.testArea.assign((size_t)maxTest + 1, 0);
+    for (const Cell& c : table.cells) {
+        table.refArea[c.ref] += c.count;
+        table.testArea[c.test] += c.count;
+        table.total += c.count;
+    }
+    return table;
+}
+
+vector<int> ContingencyTable::bestRefForTest() const {
+    vector<int> best(testArea.size(), 0);
+    vector<int64_t> bestCount(testArea.size(), -1);
+    // cells 按参考标签升序，严格大于才更新即可在平局时保留较小的参考标签
+    for (const Cell& c : cells) {
+        if (c.test == 0) continue;
+        if (c.count > bestCount[c.test]) {
+            bestCount[c.test] = c.count;
+            best[c.test] = c.ref;
+        }
+    }
+    return best;
+}
+
+double ContingencyTable::pixelAccuracy() const {
+    if (total == 0) return 0.0;
+    const vector<int> best = bestRefForTest();
+    int64_t agree = 0;
+    for (const Cell& c : cells) {
+        // 测试背景映射为 0，只有参考也是背景才一致；其余像素映射到最佳参考标签
+        if (c.test == 0 ? c.ref == 0 : c.ref == best[c.test]) agree += c.count;
+    }
+    return (double)agree / (double)total;
+}
+
+double ContingencyTable::meanIoU() const {
+    double sumMaxIoU = 0.0;
+    int count = 0;
+    // 同一参考标签的项在 cells 中连续
+    for (size_t i = 0; i < cells.size();) {
+        const int r = cells[i].ref;
+        double best = 0.0;
+        size_t j = i;
+        for (; j < cells.size() && cells[j].ref == r; ++j) {
+            const Cell& c = cells[j];
+            if (r == 0 || c.test == 0) continue;
+            const int64_t uni = refArea[r] + testArea[c.test] - c.count;
+            best = max(best, (double)c.count / (double)uni);
+        }
+        if (r > 0) {
+            sumMaxIoU += best;
+            ++count;
+        }
+        i = j;
+    }
+    return count > 0 ? sumMaxIoU / count : 0.0;
+}
+
+double ContingencyTable::adjustedRandIndex() const {
+    if (total < 2) return 1.0;
+    double sumCells = 0.0, sumRef = 0.0, sumTest = 0.0;
+    for (const Cell& c : cells) sumCells += pairs((double)c.count);
+    for (int64_t a : refArea) sumRef += pairs((double)a);
+    for (int64_t b : testArea) sumTest += pairs((double)b);
+
+    const double expected = sumRef * sumTest / pairs((double)total);
+    const double maxIndex = (sumRef + sumTest) / 2;
+    // 两种划分都是单一类（或都是全部单点）时分母为 0，此时两者必然一致
+    if (maxIndex == expected) return 1.0;
+    return (sumCells - expected) / (maxIndex - expected);
+}
@@ -0,0 +1,33 @@
+﻿#pragma once
+#include <opencv2/opencv.hpp>
+#include <cstdint>
+#include <vector>
+
+class ThreadPool;
+
+// 两幅标记图的列联表：cells 中每一项是 (参考标签 r, 测试标签 t) 同时出现的像素数，
+// 只存非零项并按 (r, t) 升序排列；标签 0（背景）也计入。
+// 一次扫描建表，之后各项评价指标都只在表上计算，与图像大小无关。
+struct ContingencyTable {
+    struct Cell {
+        int ref, test;
+        int64_t count;
+    };
+
+    std::vector<Cell> cells;
+    std::vector<int64_t> refArea, testArea;  // 各标签的像素数（边缘分布），下标为标签
+    int64_t total = 0;
+
+    // 建表：两幅图尺寸相同，类型为 CV_32S 或 CV_16U。pool 非空时按行块并行统计后归并
+    static ContingencyTable build(const cv::Mat& refLabels, const cv::Mat& testLabels, ThreadPool* pool = nullptr);
+
+    // 每个测试标签重叠像素最多的参考标签（背景 0 -> 0；平局取较小的参考标签）
+    std::vector<int> bestRefForTest() const;
+
+    // 把测试标签按 bestRefForTest 映射后与参考标签逐像素比较的一致率
+    double pixelAccuracy() const;
+    // 对每个参考连通域取与之 IoU 最大的测试连通域，求平均（背景不参与）
+    double meanIoU() const;
+    // 调整兰德指数：把背景也视为一类，1 表示两种划分完全一致，随机划分期望为 0
+    double adjustedRandIndex() const;
+};
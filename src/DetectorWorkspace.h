@@ -0,0 +1,87 @@
+﻿#pragma once
+#include "Instrumentation.h"
+#include <opencv2/opencv.hpp>
+#include <map>
+#include <memory>
+#include <typeindex>
+#include <utility>
+#include <vector>
+
+// 检测器工作区：在多次 detect 调用之间保留临时缓冲区。
+// 同尺寸图像重复调用时缓冲区容量已经足够，不再发生堆分配；
+// counters() 记录实际发生的分配，稳态下 allocations 应保持不变。
+// 一个工作区可以被多个检测器共享（依次调用，不可并发）。
+class DetectorWorkspace {
+public:
+    struct Counters {
+        size_t allocations = 0;     // 缓冲区扩容、输出矩阵重新分配等真实堆分配次数
+        size_t bytesAllocated = 0;  // 上述分配的总字节数
+        size_t requests = 0;        // 缓冲区请求次数
+    };
+
+    // 取得类型为 T、编号为 slot 的对象：首次请求时默认构造，之后一直保留
+    template <typename T>
+    T& get(int slot) {
+        ++m_counters.requests;
+        auto key = std::make_pair(std::type_index(typeid(T)), slot);
+        auto it = m_slots.find(key);
+        if (it == m_slots.end()) {
+            noteAllocation(sizeof(Slot<T>));
+            it = m_slots.emplace(key, std::unique_ptr<SlotBase>(new Slot<T>())).first;
+        }
+        return static_cast<Slot<T>*>(it->second.get())->value;
+    }
+
+    // 保证 v 的容量至少为 n，只有真正扩容时才计入分配
+    template <typename T>
+    void reserve(std::vector<T>& v, size_t n) {
+        if (v.capacity() >= n) return;
+        noteAllocation(n * sizeof(T));
+        v.reserve(n);
+    }
+
+    // 对边扫描边 push_back 的缓冲区：扫描前记下容量，扫描后调用，若发生扩容则计入分配
+    template <typename T>
+    void noteGrowth(const std::vector<T>& v, size_t oldCapacity) {
+        if (v.capacity() != oldCapacity) noteAllocation(v.capacity() * sizeof(T));
+    }
+
+    template <typename T>
+    void assign(std::vector<T>& v, size_t n, const T& value) {
+        reserve(v, n);
+        v.assign(n, value);
+    }
+
+    // 让 out 成为 rows x cols、类型为 type 的矩阵；尺寸与类型一致时原样复用（内容不清零）
+    void prepare(cv::Mat& out, int rows, int cols, int type) {
+        if (!out.empty() && out.rows == rows && out.cols == cols && out.type() == type) return;
+        out.create(rows, cols, type);
+        noteAllocation(out.total() * out.elemSize());
+    }
+
+    // 检测器自行管理的内存发生分配时调用
+    void noteAllocation(size_t bytes) {
+        ++m_counters.allocations;
+        m_counters.bytesAllocated += bytes;
+        CC_COUNT(kAllocations, 1);
+        CC_COUNT(kBytesAllocated, bytes);
+    }
+
+    const Counters& counters() const { return m_counters; }
+    void resetCounters() { m_counters = Counters(); }
+
+    // 释放所有缓冲区
+    void clear() { m_slots.clear(); }
+
+private:
+    struct SlotBase {
+        virtual ~SlotBase() = default;
+    };
+    template <typename T>
+    struct Slot : SlotBase {
+        T value;
+    };
+
+    std::map<std::pair<std::type_index, int>, std::unique_ptr<SlotBase>> m_slots;
+    Counters m_counters;
+};
@@ -1,4 +1,6 @@
 ﻿#pragma once
+#include "ComponentStats.h"
+#include "DetectorWorkspace.h"
 #include <opencv2/opencv.hpp>
 #include <string>
 
@@ -9,4 +11,41 @@ public:
     virtual cv::Mat detect(const cv::Mat& binary, int minSize = 0) = 0;
     virtual std::string name() const = 0;
     virtual int numComponents() const = 0;
+
+    // 标记的同时输出每个连通域的统计表，minSize 过滤同样作用于统计表。
+    virtual cv::Mat detectWithStats(const cv::Mat& binary, ComponentStats& stats, int minSize = 0, bool withPerimeter = false) {
+        cv::Mat labels;
+        detectInto(binary, labels, minSize, &stats, withPerimeter);
+        return labels;
+    }
+
+    // 把结果写入调用方提供的 labels：尺寸与类型一致时直接复用其内存，
+    // 配合工作区可使同尺寸的重复调用不发生堆分配。stats 非空时同时输出统计表。
+    // 默认实现退化为 detect() 后再扫描一遍标记矩阵；内置检测器都在重映射阶段顺带累加。
+    virtual void detectInto(const cv::Mat& binary, cv::Mat& labels, int minSize = 0,
+                            ComponentStats* stats = nullptr, bool withPerimeter = false) {
+        labels = detect(binary, minSize);
+        if (stats && !labels.empty()) ComponentStats::fromLabels(binary, labels, numComponents(), withPerimeter, *stats);
+        if (!labels.empty() && labels.depth() != outputDepth(numComponents())) labels.convertTo(labels, outputDepth(numComponents()));
+    }
+
+    // 输出标签类型：CV_32S（默认）或 CV_16U。CV_16U 使标签图的写出带宽减半，
+    // 连通域数超过 65535 时该次调用自动退回 CV_32S
+    void setLabelDepth(int depth) { m_labelDepth = depth == CV_16U ? CV_16U : CV_32S; }
+    int labelDepth() const { return m_labelDepth; }
+
+    // 使用外部工作区（可在多个检测器之间共享）；传 nullptr 恢复使用检测器自带的工作区
+    void setWorkspace(DetectorWorkspace* workspace) { m_workspace = workspace; }
+    DetectorWorkspace& workspace() { return m_workspace ? *m_workspace : m_ownWorkspace; }
+
+protected:
+    // 按最终连通域数确定本次输出的深度
+    int outputDepth(int numComponents) const {
+        return m_labelDepth == CV_16U && numComponents <= 0xFFFF ? CV_16U : CV_32S;
+    }
+
+private:
+    int m_labelDepth = CV_32S;
+    DetectorWorkspace m_ownWorkspace;
+    DetectorWorkspace* m_workspace = nullptr;
 };
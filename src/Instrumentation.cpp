@@ -0,0 +1,87 @@
+﻿#include "Instrumentation.h"
+#include <iomanip>
+
+using namespace std;
+
+namespace Instrumentation {
+
+static atomic<Profile*> g_current{nullptr};
+
+Profile* current() { return g_current.load(memory_order_acquire); }
+
+Scope::Scope(Profile* profile) : m_previous(g_current.exchange(profile, memory_order_acq_rel)) {}
+
+Scope::~Scope() { g_current.store(m_previous, memory_order_release); }
+
+void PhaseSequence::stop() {
+    if (!m_name) return;
+    if (Profile* p = current())
+        p->addPhase(m_name, chrono::duration<double, milli>(chrono::steady_clock::now() - m_start).count());
+    m_name = nullptr;
+}
+
+void Profile::reset() {
+    {
+        lock_guard<mutex> lock(m_mutex);
+        m_phases.clear();
+    }
+    for (auto& c : m_counters) c.store(0, memory_order_relaxed);
+    for (auto& b : m_findPath) b.store(0, memory_order_relaxed);
+}
+
+void Profile::addPhase(const char* name, double ms) {
+    lock_guard<mutex> lock(m_mutex);
+    auto it = find_if(m_phases.begin(), m_phases.end(), [&](const Phase& p) { return p.name == name; });
+    if (it == m_phases.end()) it = m_phases.insert(m_phases.end(), Phase{name});
+    it->ms += ms;
+    it->calls++;
+}
+
+void Profile::high(Counter c, int64_t v) {
+    int64_t cur = m_counters[c].load(memory_order_relaxed);
+    while (cur < v && !m_counters[c].compare_exchange_weak(cur, v, memory_order_relaxed)) {
+    }
+}
+
+void Profile::merge(const LocalCounters& local) {
+    if (local.unions) add(kUnions, local.unions);
+    for (int i = 0; i < kPathBuckets; ++i)
+        if (local.findPath[i]) m_findPath[i].fetch_add(local.findPath[i], memory_order_relaxed);
+}
+
+vector<Profile::Phase> Profile::phases() const {
+    lock_guard<mutex> lock(m_mutex);
+    return m_phases;
+}
+
+const char* Profile::counterName(Counter c) {
+    static const char* kNames[kNumCounters] = {"unions", "provisionalLabels", "bfsQueuePeak", "bytesAllocated", "allocations"};
+    return kNames[c];
+}
+
+void Profile::writeJson(ostream& os, int indent) const {
+    const string pad(indent, ' ');
+    os << "{\n" << pad << "  \"enabled\": " << (enabled() ? "true" : "false") << ",\n";
+
+    os << pad << "  \"phases\": [";
+    const vector<Phase> list = phases();
+    for (size_t i = 0; i < list.size(); ++i) {
+        os << (i ? ",\n" : "\n") << pad << "    {\"name\": \"" << list[i].name << "\", \"ms\": " << fixed << setprecision(4)
+           << list[i].ms << ", \"calls\": " << list[i].calls << "}";
+    }
+    os << (list.empty() ? "],\n" : "\n" + pad + "  ],\n");
+
+    os << pad << "  \"counters\": {";
+    for (int c = 0; c < kNumCounters; ++c)
+        os << (c ? ", " : "") << "\"" << counterName((Counter)c) << "\": " << counter((Counter)c);
+    os << "},\n";
+
+    // 直方图去掉末尾的空格子
+    int last = kPathBuckets;
+    while (last > 0 && findPath(last - 1) == 0) --last;
+    os << pad << "  \"findPathLength\": [";
+    for (int i = 0; i < last; ++i) os << (i ? ", " : "") << findPath(i);
+    os << "]\n" << pad << "}";
+}
+
+}  // namespace Instrumentation
@@ -0,0 +1,143 @@
+﻿#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+// 热路径插桩：各检测器按阶段上报墙钟时间与算法计数器（合并次数、查找路径长度分布、
+// BFS 队列峰值、分配字节数、临时标签数），汇总到调用方通过 Scope 指定的 Profile 中。
+// 只有定义了 CC_INSTRUMENTATION（CMake 选项 CC_ENABLE_INSTRUMENTATION）时下面的宏才有内容，
+// 否则全部展开为空，热循环中不留任何痕迹；Profile 本身始终可用，未启用时内容为空。
+namespace Instrumentation {
+
+enum Counter { kUnions, kProvisionalLabels, kBfsQueuePeak, kBytesAllocated, kAllocations, kNumCounters };
+
+// 查找路径长度直方图：下标为从起点走到根的跳数，最后一格收集所有更长的路径
+constexpr int kPathBuckets = 33;
+
+// 编译时是否启用插桩
+constexpr bool enabled() {
+#ifdef CC_INSTRUMENTATION
+    return true;
+#else
+    return false;
+#endif
+}
+
+// 局部累加器：热循环里只写普通成员，阶段结束时用 CC_FLUSH 一次性并入当前 Profile
+struct LocalCounters {
+    int64_t unions = 0;
+    int64_t findPath[kPathBuckets] = {};
+
+    void find(int hops) { ++findPath[std::min(hops, kPathBuckets - 1)]; }
+    void clear() { *this = LocalCounters(); }
+};
+
+class Profile {
+public:
+    struct Phase {
+        std::string name;
+        double ms = 0;
+        int64_t calls = 0;
+    };
+
+    Profile() { reset(); }
+    Profile(const Profile&) = delete;
+    Profile& operator=(const Profile&) = delete;
+
+    void reset();
+
+    // 可被多个线程同时调用
+    void addPhase(const char* name, double ms);
+    void add(Counter c, int64_t n) { m_counters[c].fetch_add(n, std::memory_order_relaxed); }
+    void high(Counter c, int64_t v);
+    void merge(const LocalCounters& local);
+
+    int64_t counter(Counter c) const { return m_counters[c].load(std::memory_order_relaxed); }
+    int64_t findPath(int hops) const { return m_findPath[hops].load(std::memory_order_relaxed); }
+    // 按首次出现的顺序
+    std::vector<Phase> phases() const;
+
+    // 输出 JSON 对象（不含结尾换行），indent 为每行的起始缩进
+    void writeJson(std::ostream& os, int indent = 0) const;
+
+    static const char* counterName(Counter c);
+
+private:
+    mutable std::mutex m_mutex;
+    std::vector<Phase> m_phases;
+    std::atomic<int64_t> m_counters[kNumCounters];
+    std::atomic<int64_t> m_findPath[kPathBuckets];
+};
+
+// 当前接收上报的 Profile（进程内全局，线程池中的工作线程同样上报到这里），为空时丢弃
+Profile* current();
+
+// 在作用域内把上报目标设为 profile，结束时恢复原值；同一时刻只应有一个被剖析的区域
+class Scope {
+public:
+    explicit Scope(Profile* profile);
+    ~Scope();
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+private:
+    Profile* m_previous;
+};
+
+// 函数内依次进行的若干阶段：next() 结束上一阶段并开始新阶段，析构时结束最后一个阶段
+class PhaseSequence {
+public:
+    PhaseSequence() = default;
+    ~PhaseSequence() { stop(); }
+    PhaseSequence(const PhaseSequence&) = delete;
+    PhaseSequence& operator=(const PhaseSequence&) = delete;
+
+    void next(const char* name) {
+        stop();
+        m_name = name;
+        m_start = std::chrono::steady_clock::now();
+    }
+    void stop();
+
+private:
+    const char* m_name = nullptr;
+    std::chrono::steady_clock::time_point m_start;
+};
+
+inline void count(Counter c, int64_t n) {
+    if (Profile* p = current()) p->add(c, n);
+}
+inline void high(Counter c, int64_t v) {
+    if (Profile* p = current()) p->high(c, v);
+}
+inline void flush(LocalCounters& local) {
+    if (Profile* p = current()) p->merge(local);
+    local.clear();
+}
+
+}  // namespace Instrumentation
+
+#ifdef CC_INSTRUMENTATION
+// 仅在启用插桩时存在的语句或成员声明
+#define CC_INSTR(...) __VA_ARGS__
+#define CC_PHASES() Instrumentation::PhaseSequence ccPhases_
+#define CC_PHASE(name) ccPhases_.next(name)
+#define CC_PHASE_END() ccPhases_.stop()
+#define CC_COUNT(counter, n) Instrumentation::count(Instrumentation::counter, (int64_t)(n))
+#define CC_MAX(counter, v) Instrumentation::high(Instrumentation::counter, (int64_t)(v))
+#define CC_FLUSH(local) Instrumentation::flush(local)
+#else
+#define CC_INSTR(...)
+#define CC_PHASES() ((void)0)
+#define CC_PHASE(name) ((void)0)
+#define CC_PHASE_END() ((void)0)
+#define CC_COUNT(counter, n) ((void)0)
+#define CC_MAX(counter, v) ((void)0)
+#define CC_FLUSH(local) ((void)0)
+#endif
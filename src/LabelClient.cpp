@@ -0,0 +1,139 @@
+﻿#include "LabelClient.h"
+#include <atomic>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace cv;
+using namespace std;
+using namespace LabelProtocol;
+
+LabelClient::~LabelClient() { close(); }
+
+size_t LabelClient::slotBytesFor(int rows, int cols, int maxComponents) {
+    const size_t labels = alignUp((size_t)rows * cols * sizeof(int32_t));
+    return outputOffset(rows, cols) + labels + (size_t)maxComponents * sizeof(StatsEntry);
+}
+
+bool LabelClient::connect(const string& socketPath, int slots, size_t slotBytes) {
+    close();
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    if (slots <= 0 || slotBytes == 0 || socketPath.size() >= sizeof(addr.sun_path)) {
+        cerr << "连接参数无效: " << socketPath << endl;
+        return false;
+    }
+    strncpy(addr.sun_path, socketPath.c_str(), sizeof(addr.sun_path) - 1);
+
+    m_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (m_fd < 0 || ::connect(m_fd, (const sockaddr*)&addr, sizeof(addr)) != 0) {
+        cerr << "无法连接标记服务: " << socketPath << " (" << strerror(errno) << ")" << endl;
+        close();
+        return false;
+    }
+    disableSigpipe(m_fd);
+
+    // 共享内存名称在本进程内唯一；服务端映射之后即删除名称，两端退出后自动回收
+    static atomic<int> counter{0};
+    Request q;
+    q.kind = kAttach;
+    snprintf(q.shmName, sizeof(q.shmName), "/cc_label_%d_%d", (int)getpid(), counter++);
+    q.slots = (uint32_t)slots;
+    q.slotBytes = alignUp(slotBytes);
+    m_slotBytes = (size_t)q.slotBytes;
+    m_shmBytes = m_slotBytes * slots;
+
+    const int shmFd = shm_open(q.shmName, O_RDWR | O_CREAT | O_EXCL, 0600);
+    void* p = MAP_FAILED;
+    if (shmFd >= 0) {
+        if (ftruncate(shmFd, (off_t)m_shmBytes) == 0)
+            p = mmap(nullptr, m_shmBytes, PROT_READ | PROT_WRITE, MAP_SHARED, shmFd, 0);
+        ::close(shmFd);
+    }
+    if (p == MAP_FAILED) {
+        cerr << "无法创建共享内存: " << q.shmName << " (" << strerror(errno) << ")" << endl;
+        if (shmFd >= 0) shm_unlink(q.shmName);
+        close();
+        return false;
+    }
+    m_shm = static_cast<uchar*>(p);
+    m_slots = slots;
+
+    Reply reply;
+    const bool attached = roundTrip(q, reply) && reply.status == kOk;
+    shm_unlink(q.shmName);
+    if (!attached) {
+        cerr << "标记服务拒绝映射共享内存" << endl;
+        close();
+        return false;
+    }
+    return true;
+}
+
+void LabelClient::close() {
+    if (m_shm) munmap(m_shm, m_shmBytes);
+    if (m_fd >= 0) ::close(m_fd);
+    m_shm = nullptr;
+    m_fd = -1;
+    m_slots = 0;
+}
+
+Mat LabelClient::input(int slot, int rows, int cols) {
+    if (!m_shm || slot < 0 || slot >= m_slots || (size_t)rows * cols > m_slotBytes) return Mat();
+    return Mat(rows, cols, CV_8UC1, m_shm + (size_t)slot * m_slotBytes);
+}
+
+uint64_t LabelClient::submit(int slot, int rows, int cols, int minSize, uint32_t flags, int threshold) {
+    if (m_fd < 0) return 0;
+    Request q;
+    q.kind = kLabel;
+    q.id = m_nextId++;
+    q.slot = (uint32_t)slot;
+    q.rows = rows;
+    q.cols = cols;
+    q.threshold = threshold;
+    q.minSize = minSize;
+    q.flags = flags;
+    return sendAll(m_fd, &q, sizeof(q)) ? q.id : 0;
+}
+
+bool LabelClient::wait(Reply& reply) {
+    return m_fd >= 0 && recvAll(m_fd, &reply, sizeof(reply)) && reply.magic == kMagic;
+}
+
+Mat LabelClient::labels(const Reply& reply) const {
+    if (!m_shm || reply.status != kOk || reply.labelBytes == 0 || reply.slot >= (uint32_t)m_slots) return Mat();
+    const int depth = reply.labelBytes == 2 ? CV_16U : CV_32S;
+    return Mat(reply.rows, reply.cols, depth, m_shm + (size_t)reply.slot * m_slotBytes + reply.labelsOffset);
+}
+
+const StatsEntry* LabelClient::stats(const Reply& reply) const {
+    if (!m_shm || reply.status != kOk || reply.statsOffset == 0 || reply.slot >= (uint32_t)m_slots) return nullptr;
+    return reinterpret_cast<const StatsEntry*>(m_shm + (size_t)reply.slot * m_slotBytes + reply.statsOffset);
+}
+
+bool LabelClient::queryLatency(Reply& reply) {
+    Request q;
+    q.kind = kQueryStats;
+    q.id = m_nextId++;
+    return roundTrip(q, reply) && reply.status == kOk;
+}
+
+int LabelClient::label(const Mat& binary, Mat& labels, int minSize, bool eight) {
+    Mat frame = input(0, binary.rows, binary.cols);
+    if (frame.empty() || binary.type() != CV_8UC1) return -1;
+    binary.copyTo(frame);
+    const uint32_t flags = kWantLabels | (eight ? (uint32_t)kEightConnectivity : 0u);
+    Reply reply;
+    if (!submit(0, binary.rows, binary.cols, minSize, flags) || !wait(reply) || reply.status != kOk) return -1;
+    this->labels(reply).copyTo(labels);
+    return reply.numComponents;
+}
+
+bool LabelClient::roundTrip(Request& request, Reply& reply) {
+    return m_fd >= 0 && sendAll(m_fd, &request, sizeof(request)) && wait(reply) && reply.id == request.id;
+}
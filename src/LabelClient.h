@@ -0,0 +1,51 @@
+﻿#pragma once
+#include "LabelProtocol.h"
+#include <opencv2/opencv.hpp>
+#include <string>
+
+// 标记服务的客户端。connect() 创建共享内存环形缓冲区（slots 个槽）并通知服务端映射，
+// 之后帧直接写入 input() 返回的矩阵，submit() 只发送定长请求；结果由服务端写回同一个槽。
+// 同一个槽在收到对应回复之前不要改写。一个实例只供一个线程使用。仅在 POSIX 平台提供。
+class LabelClient {
+public:
+    LabelClient() = default;
+    ~LabelClient();
+    LabelClient(const LabelClient&) = delete;
+    LabelClient& operator=(const LabelClient&) = delete;
+
+    // 槽大小下限：输入帧 + 标记矩阵（按 int32 计）+ maxComponents 项统计表
+    static size_t slotBytesFor(int rows, int cols, int maxComponents = 0);
+
+    bool connect(const std::string& socketPath, int slots, size_t slotBytes);
+    void close();
+    bool connected() const { return m_fd >= 0; }
+    int slots() const { return m_slots; }
+
+    // 第 slot 个槽的输入帧，零拷贝
+    cv::Mat input(int slot, int rows, int cols);
+    // 发送标记请求，返回请求 id（失败为 0）；flags 见 LabelProtocol::Flags
+    uint64_t submit(int slot, int rows, int cols, int minSize = 0, uint32_t flags = LabelProtocol::kWantLabels,
+                    int threshold = -1);
+    // 阻塞等待下一条回复
+    bool wait(LabelProtocol::Reply& reply);
+
+    // 回复中的结果，直接引用共享内存，下次使用该槽前有效
+    cv::Mat labels(const LabelProtocol::Reply& reply) const;
+    const LabelProtocol::StatsEntry* stats(const LabelProtocol::Reply& reply) const;
+
+    // 查询服务端累计的延迟分位数；须在没有未完成请求时调用
+    bool queryLatency(LabelProtocol::Reply& reply);
+
+    // 便捷接口：经槽 0 同步标记一帧，结果拷贝到 labels，返回连通域数（失败为 -1）
+    int label(const cv::Mat& binary, cv::Mat& labels, int minSize = 0, bool eight = false);
+
+private:
+    bool roundTrip(LabelProtocol::Request& request, LabelProtocol::Reply& reply);
+
+    int m_fd = -1;
+    uchar* m_shm = nullptr;
+    size_t m_shmBytes = 0;
+    int m_slots = 0;
+    size_t m_slotBytes = 0;
+    uint64_t m_nextId = 1;
+};
@@ -0,0 +1,64 @@
+﻿#pragma once
+#include "Instrumentation.h"
+#include <algorithm>
+#include <vector>
+
+// 扁平等价表：临时标签按扫描顺序递增分配，parent[l] <= l 恒成立。
+// 合并时总是让较小的标签做根，因此每个连通域的根就是它最早分配的临时标签；
+// flatten() 之后 parent[l] 直接就是 l 的根，最终重映射只需一次查表。
+struct LabelEquivalence {
+    std::vector<int> parent;  // parent[0] 保留给背景
+    CC_INSTR(mutable Instrumentation::LocalCounters counters;)
+
+    void reset(size_t expectedLabels = 0) {
+        CC_INSTR(counters.clear();)
+        parent.clear();
+        parent.reserve(expectedLabels + 1);
+        parent.push_back(0);
+    }
+
+    int newLabel() {
+        int l = (int)parent.size();
+        parent.push_back(l);
+        return l;
+    }
+
+    // 临时标签数（含背景 0）
+    int size() const { return (int)parent.size(); }
+
+    int findRoot(int l) const {
+        CC_INSTR(int hops = 0;)
+        while (parent[l] < l) {
+            l = parent[l];
+            CC_INSTR(++hops;)
+        }
+        CC_INSTR(counters.find(hops);)
+        return l;
+    }
+
+    // 合并两个标签所在集合，并把两条路径都压缩到新根上
+    int merge(int a, int b) {
+        const int ra = findRoot(a), rb = findRoot(b);
+        CC_INSTR(counters.unions += ra != rb;)
+        int root = std::min(ra, rb);
+        setRoot(a, root);
+        setRoot(b, root);
+        return root;
+    }
+
+    // 由于 parent[l] < l，按升序处理一遍即可把所有标签直接指向根
+    void flatten() {
+        for (size_t l = 1; l < parent.size(); ++l)
+            parent[l] = parent[parent[l]];
+    }
+
+private:
+    void setRoot(int l, int root) {
+        while (parent[l] < l) {
+            int next = parent[l];
+            parent[l] = root;
+            l = next;
+        }
+        parent[l] = root;
+    }
+};
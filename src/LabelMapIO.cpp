@@ -0,0 +1,411 @@
+﻿#include "LabelMapIO.h"
+#include "LabelingKernels.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <type_traits>
+
+using namespace cv;
+using namespace std;
+
+static const char kRleMagic[4] = {'C', 'C', 'L', 'R'};
+static const char kRawMagic[8] = {'C', 'C', 'L', 'R', 'A', 'W', '0', '1'};
+static const int kRleHeaderBytes = 20;
+static const int kVersion = 1;
+// 写文件时缓冲区达到该大小就刷新一次
+static const size_t kFlushBytes = 1 << 16;
+
+// 输出缓冲：按需扩容、只在扩容时清零，避免逐字节 push_back；
+// 绑定了文件流时每行结束后检查并按块刷新，否则全部留在内存中
+class ByteSink {
+public:
+    ByteSink(vector<uchar>& buf, ostream* os = nullptr) : m_buf(buf), m_len(buf.size()), m_os(os) {}
+
+    // 预留至少 n 字节的可写空间，返回写指针；写完后用 commit 提交实际长度
+    uchar* reserve(size_t n) {
+        if (m_buf.size() < m_len + n) m_buf.resize(max(m_len + n, m_buf.size() * 2));
+        return m_buf.data() + m_len;
+    }
+    void commit(const uchar* end) { m_len = end - m_buf.data(); }
+
+    void endRow() {
+        if (m_os && m_len >= kFlushBytes) flush();
+    }
+    bool finish() {
+        if (m_os) flush();
+        else m_buf.resize(m_len);
+        return !m_os || (bool)*m_os;
+    }
+
+private:
+    void flush() {
+        m_os->write((const char*)m_buf.data(), (streamsize)m_len);
+        m_len = 0;
+    }
+
+    vector<uchar>& m_buf;
+    size_t m_len;
+    ostream* m_os;
+};
+
+static uchar* putVarint(uchar* p, uint32_t v) {
+    while (v >= 0x80) {
+        *p++ = (uchar)(v | 0x80);
+        v >>= 7;
+    }
+    *p++ = (uchar)v;
+    return p;
+}
+
+static uchar* putU32(uchar* p, uint32_t v) {
+    for (int i = 0; i < 4; ++i) *p++ = (uchar)(v >> (8 * i));
+    return p;
+}
+
+static uint32_t getU32(const uchar* p) {
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static int labelBytes(int depth) { return depth == CV_16U ? 2 : 4; }
+
+static void putRleHeader(ByteSink& sink, int rows, int cols, int numComponents, int depth) {
+    uchar* p = sink.reserve(kRleHeaderBytes);
+    memcpy(p, kRleMagic, 4);
+    p[4] = (uchar)kVersion;
+    p[5] = (uchar)labelBytes(depth);
+    p[6] = p[7] = 0;
+    p = putU32(p + 8, (uint32_t)rows);
+    p = putU32(p, (uint32_t)cols);
+    p = putU32(p, (uint32_t)numComponents);
+    sink.commit(p);
+}
+
+static void putRawHeader(uchar* p, int rows, int cols, int numComponents, int depth) {
+    memset(p, 0, LabelMapIO::kRawHeaderBytes);
+    memcpy(p, kRawMagic, 8);
+    p = putU32(p + 8, (uint32_t)kVersion);
+    p = putU32(p, (uint32_t)labelBytes(depth));
+    p = putU32(p, (uint32_t)rows);
+    p = putU32(p, (uint32_t)cols);
+    putU32(p, (uint32_t)numComponents);
+}
+
+// 一行游程：先把各段写在预留的 5 字节之后，再把游程数的 varint 紧贴到段数据前面
+template <typename LabelT>
+static void putRowRuns(ByteSink& sink, const LabelT* row, int cols) {
+    uchar* base = sink.reserve(5 + (size_t)15 * ((cols + 1) / 2 + 1));
+    uchar* p = base + 5;
+    uint32_t count = 0;
+    int prevEnd = 0;
+    for (int x = 0; x < cols;) {
+        const LabelT l = row[x];
+        if (!l) {
+            ++x;
+            continue;
+        }
+        const int start = x;
+        while (x < cols && row[x] == l) ++x;
+        p = putVarint(p, (uint32_t)(start - prevEnd));
+        p = putVarint(p, (uint32_t)(x - start));
+        p = putVarint(p, (uint32_t)l);
+        prevEnd = x;
+        ++count;
+    }
+    uchar head[5];
+    const int headLen = (int)(putVarint(head, count) - head);
+    memmove(base + headLen, base + 5, p - (base + 5));
+    memcpy(base, head, headLen);
+    sink.commit(p - (5 - headLen));
+    sink.endRow();
+}
+
+static bool checkLabels(const Mat& labels) {
+    if (labels.empty() || labels.channels() != 1 || (labels.depth() != CV_16U && labels.depth() != CV_32S)) {
+        cerr << "标记矩阵必须为单通道 CV_16U 或 CV_32S" << endl;
+        return false;
+    }
+    return true;
+}
+
+static bool encodeRleTo(ByteSink& sink, const Mat& labels, int numComponents) {
+    putRleHeader(sink, labels.rows, labels.cols, numComponents, labels.depth());
+    LabelingKernels::dispatchLabelType(labels.depth(), [&](auto tag) {
+        using LabelT = typename decltype(tag)::type;
+        for (int y = 0; y < labels.rows; ++y) putRowRuns(sink, labels.ptr<LabelT>(y), labels.cols);
+    });
+    return sink.finish();
+}
+
+static bool encodeRleTo(ByteSink& sink, const RunLengthLabels& rl, int depth) {
+    putRleHeader(sink, rl.rows, rl.cols, rl.numComponents, depth);
+    for (int y = 0; y < rl.rows; ++y) {
+        const int begin = rl.rowStart[y], end = rl.rowStart[y + 1];
+        uchar* p = putVarint(sink.reserve(5 + (size_t)15 * (end - begin)), (uint32_t)(end - begin));
+        int prevEnd = 0;
+        for (int i = begin; i < end; ++i) {
+            const Run& r = rl.runs[i];
+            p = putVarint(p, (uint32_t)(r.xStart - prevEnd));
+            p = putVarint(p, (uint32_t)(r.xEnd - r.xStart));
+            p = putVarint(p, (uint32_t)r.label);
+            prevEnd = r.xEnd;
+        }
+        sink.commit(p);
+        sink.endRow();
+    }
+    return sink.finish();
+}
+
+bool LabelMapIO::encodeRle(const Mat& labels, int numComponents, vector<uchar>& out) {
+    if (!checkLabels(labels)) return false;
+    ByteSink sink(out);
+    return encodeRleTo(sink, labels, numComponents);
+}
+
+void LabelMapIO::encodeRle(const RunLengthLabels& rl, vector<uchar>& out, int depth) {
+    ByteSink sink(out);
+    encodeRleTo(sink, rl, depth);
+}
+
+void LabelMapIO::encodeRawHeader(uchar* header, int rows, int cols, int numComponents, int depth) {
+    putRawHeader(header, rows, cols, numComponents, depth);
+}
+
+bool LabelMapIO::encodeRaw(const Mat& labels, int numComponents, vector<uchar>& out) {
+    if (!checkLabels(labels)) return false;
+    const size_t rowBytes = labels.cols * labels.elemSize();
+    const size_t offset = out.size();
+    out.resize(offset + kRawHeaderBytes + rowBytes * labels.rows);
+    putRawHeader(out.data() + offset, labels.rows, labels.cols, numComponents, labels.depth());
+    uchar* dst = out.data() + offset + kRawHeaderBytes;
+    for (int y = 0; y < labels.rows; ++y, dst += rowBytes) memcpy(dst, labels.ptr(y), rowBytes);
+    return true;
+}
+
+static bool openForWrite(const string& path, ofstream& os) {
+    os.open(path, ios::binary);
+    if (!os) cerr << "无法写入文件: " << path << endl;
+    return (bool)os;
+}
+
+bool LabelMapIO::writeRle(const string& path, const Mat& labels, int numComponents) {
+    ofstream os;
+    if (!checkLabels(labels) || !openForWrite(path, os)) return false;
+    vector<uchar> buf;
+    ByteSink sink(buf, &os);
+    return encodeRleTo(sink, labels, numComponents);
+}
+
+bool LabelMapIO::writeRle(const string& path, const RunLengthLabels& rl, int depth) {
+    ofstream os;
+    if (!openForWrite(path, os)) return false;
+    vector<uchar> buf;
+    ByteSink sink(buf, &os);
+    return encodeRleTo(sink, rl, depth);
+}
+
+bool LabelMapIO::writeRaw(const string& path, const Mat& labels, int numComponents) {
+    ofstream os;
+    if (!checkLabels(labels) || !openForWrite(path, os)) return false;
+    uchar header[kRawHeaderBytes];
+    putRawHeader(header, labels.rows, labels.cols, numComponents, labels.depth());
+    os.write((const char*)header, kRawHeaderBytes);
+    // 元素按主机字节序直接写出（小端主机即为小端）
+    const size_t rowBytes = labels.cols * labels.elemSize();
+    if (labels.isContinuous()) {
+        os.write((const char*)labels.ptr(), (streamsize)(rowBytes * labels.rows));
+    } else {
+        for (int y = 0; y < labels.rows; ++y) os.write((const char*)labels.ptr(y), (streamsize)rowBytes);
+    }
+    return (bool)os;
+}
+
+static bool formatError(const string& path) {
+    cerr << "标记文件格式错误: " << path << endl;
+    return false;
+}
+
+static bool parseHeader(const uchar* p, size_t n, LabelMapIO::Header& h) {
+    if (n >= (size_t)LabelMapIO::kRawHeaderBytes && memcmp(p, kRawMagic, 8) == 0) {
+        const uint32_t bytes = getU32(p + 12);
+        if (getU32(p + 8) != (uint32_t)kVersion || (bytes != 2 && bytes != 4)) return false;
+        h.format = LabelMapIO::kRaw;
+        h.depth = bytes == 2 ? CV_16U : CV_32S;
+        h.rows = (int)getU32(p + 16);
+        h.cols = (int)getU32(p + 20);
+        h.numComponents = (int)getU32(p + 24);
+    } else if (n >= (size_t)kRleHeaderBytes && memcmp(p, kRleMagic, 4) == 0) {
+        if (p[4] != kVersion || (p[5] != 2 && p[5] != 4)) return false;
+        h.format = LabelMapIO::kRle;
+        h.depth = p[5] == 2 ? CV_16U : CV_32S;
+        h.rows = (int)getU32(p + 8);
+        h.cols = (int)getU32(p + 12);
+        h.numComponents = (int)getU32(p + 16);
+    } else {
+        return false;
+    }
+    return h.rows >= 0 && h.cols >= 0 && h.numComponents >= 0;
+}
+
+bool LabelMapIO::readHeader(const string& path, Header& header) {
+    ifstream is(path, ios::binary);
+    if (!is) {
+        cerr << "无法读取文件: " << path << endl;
+        return false;
+    }
+    uchar buf[kRawHeaderBytes];
+    is.read((char*)buf, kRawHeaderBytes);
+    if (!parseHeader(buf, (size_t)is.gcount(), header)) return formatError(path);
+    return true;
+}
+
+static bool readFile(const string& path, vector<uchar>& data) {
+    ifstream is(path, ios::binary | ios::ate);
+    if (!is) {
+        cerr << "无法读取文件: " << path << endl;
+        return false;
+    }
+    data.resize((size_t)is.tellg());
+    is.seekg(0);
+    is.read((char*)data.data(), (streamsize)data.size());
+    return (bool)is;
+}
+
+// 读取原始格式的数据区到 labels；文件长度与文件头不符或标签超出 [0, numComponents] 时返回 false
+static bool readRawData(const string& path, const LabelMapIO::Header& h, Mat& labels) {
+    ifstream is(path, ios::binary | ios::ate);
+    // 先核对文件长度，避免损坏的文件头引发巨大的分配
+    const uint64_t elemBytes = h.depth == CV_16U ? 2 : 4;
+    if (!is || (uint64_t)is.tellg() < LabelMapIO::kRawHeaderBytes + (uint64_t)h.rows * h.cols * elemBytes) return false;
+    is.seekg(LabelMapIO::kRawHeaderBytes);
+    if (labels.rows != h.rows || labels.cols != h.cols || labels.type() != h.depth) labels.create(h.rows, h.cols, h.depth);
+    const size_t rowBytes = h.cols * labels.elemSize();
+    for (int y = 0; y < h.rows && is; ++y) is.read((char*)labels.ptr(y), (streamsize)rowBytes);
+    if (!is) return false;
+    // 标签按无符号数检查，负数与最高位为 1 的值同样被拒绝
+    bool ok = true;
+    LabelingKernels::dispatchLabelType(h.depth, [&](auto tag) {
+        using LabelT = typename decltype(tag)::type;
+        using UnsignedT = typename std::make_unsigned<LabelT>::type;
+        for (int y = 0; y < h.rows && ok; ++y) {
+            const LabelT* row = labels.ptr<LabelT>(y);
+            for (int x = 0; x < h.cols; ++x) {
+                if ((uint32_t)(UnsignedT)row[x] > (uint32_t)h.numComponents) {
+                    ok = false;
+                    break;
+                }
+            }
+        }
+    });
+    return ok;
+}
+
+// 逐段解码游程格式，onRun(y, x0, x1, label)；越界或截断时返回 false
+template <typename F>
+static bool decodeRle(const vector<uchar>& data, const LabelMapIO::Header& h, F&& onRun) {
+    const uchar* p = data.data() + kRleHeaderBytes;
+    const uchar* end = data.data() + data.size();
+    auto varint = [&](uint32_t& v) {
+        v = 0;
+        for (int shift = 0; shift < 35; shift += 7) {
+            if (p == end) return false;
+            const uchar b = *p++;
+            v |= (uint32_t)(b & 0x7F) << shift;
+            if (!(b & 0x80)) return true;
+        }
+        return false;
+    };
+    for (int y = 0; y < h.rows; ++y) {
+        uint32_t count;
+        if (!varint(count)) return false;
+        int64_t x = 0;
+        for (uint32_t i = 0; i < count; ++i) {
+            uint32_t gap, len, label;
+            if (!varint(gap) || !varint(len) || !varint(label)) return false;
+            const int64_t x0 = x + gap, x1 = x0 + len;
+            if (x1 > h.cols || len == 0 || label == 0 || label > (uint32_t)h.numComponents) return false;
+            onRun(y, (int)x0, (int)x1, (int)label);
+            x = x1;
+        }
+    }
+    return true;
+}
+
+bool LabelMapIO::read(const string& path, Mat& labels, int* numComponents) {
+    Header h;
+    if (!readHeader(path, h)) return false;
+    if (numComponents) *numComponents = h.numComponents;
+    if (h.format == kRaw) return readRawData(path, h, labels) || formatError(path);
+
+    vector<uchar> data;
+    if (!readFile(path, data)) return false;
+    if (labels.rows != h.rows || labels.cols != h.cols || labels.type() != h.depth) labels.create(h.rows, h.cols, h.depth);
+    labels.setTo(Scalar(0));
+    bool ok = false;
+    LabelingKernels::dispatchLabelType(h.depth, [&](auto tag) {
+        using LabelT = typename decltype(tag)::type;
+        ok = decodeRle(data, h, [&](int y, int x0, int x1, int label) {
+            fill(labels.ptr<LabelT>(y) + x0, labels.ptr<LabelT>(y) + x1, (LabelT)label);
+        });
+    });
+    return ok || formatError(path);
+}
+
+bool LabelMapIO::readRuns(const string& path, RunLengthLabels& rl) {
+    Header h;
+    if (!readHeader(path, h)) return false;
+    rl.reset(h.rows, h.cols);
+    rl.numComponents = h.numComponents;
+
+    if (h.format == kRaw) {
+        Mat labels;
+        if (!readRawData(path, h, labels)) return formatError(path);
+        LabelingKernels::dispatchLabelType(h.depth, [&](auto tag) {
+            using LabelT = typename decltype(tag)::type;
+            for (int y = 0; y < h.rows; ++y) {
+                const LabelT* row = labels.ptr<LabelT>(y);
+                for (int x = 0; x < h.cols;) {
+                    const LabelT l = row[x];
+                    if (!l) {
+                        ++x;
+                        continue;
+                    }
+                    const int start = x;
+                    while (x < h.cols && row[x] == l) ++x;
+                    rl.runs.push_back({y, start, x, (int)l});
+                }
+                rl.rowStart[y + 1] = (int)rl.runs.size();
+            }
+        });
+        return true;
+    }
+
+    vector<uchar> data;
+    if (!readFile(path, data)) return false;
+    int lastRow = 0;
+    const bool ok = decodeRle(data, h, [&](int y, int x0, int x1, int label) {
+        for (; lastRow < y; ++lastRow) rl.rowStart[lastRow + 1] = (int)rl.runs.size();
+        rl.runs.push_back({y, x0, x1, label});
+    });
+    for (; lastRow < h.rows; ++lastRow) rl.rowStart[lastRow + 1] = (int)rl.runs.size();
+    return ok || formatError(path);
+}
+
+bool LabelMapIO::readStats(const string& path, ComponentStats& stats) {
+    Header h;
+    if (!readHeader(path, h)) return false;
+    stats.reset(h.numComponents);
+
+    if (h.format == kRle) {
+        vector<uchar> data;
+        if (!readFile(path, data)) return false;
+        if (!decodeRle(data, h, [&](int y, int x0, int x1, int label) { stats.addRun(label, y, x0, x1); }))
+            return formatError(path);
+    } else {
+        RunLengthLabels rl;
+        if (!readRuns(path, rl)) return false;
+        for (const Run& r : rl.runs) stats.addRun(r.label, r.y, r.xStart, r.xEnd);
+    }
+    stats.finalize();
+    return true;
+}
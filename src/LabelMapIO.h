@@ -0,0 +1,48 @@
+﻿#pragma once
+#include "ComponentStats.h"
+#include "RunLengthLabels.h"
+#include <opencv2/opencv.hpp>
+#include <string>
+#include <vector>
+
+// 标记图的紧凑序列化，保留真实标签编号，供下游直接读取而无需重新标记。两种格式：
+// - 游程格式（.ccl）：20 字节头 + 逐行的 varint 游程（游程数，再每段 与上一段末尾的间隔、长度、标签），
+//   与 RunLengthLabels 一一对应，通常比原始标记图小一到两个数量级；
+// - 原始格式（.raw）：64 字节头 + 行优先的 uint16/uint32 小端数组，数据区 64 字节对齐，可直接 mmap 使用。
+// 写出逐行进行，不生成彩色图或其他整幅中间图像；文件写出时按块刷新，内存占用与图像大小无关。
+class LabelMapIO {
+public:
+    enum Format { kRle, kRaw };
+
+    struct Header {
+        Format format = kRle;
+        int rows = 0, cols = 0;
+        int numComponents = 0;
+        int depth = CV_32S;  // 解码得到的标记矩阵深度：CV_16U 或 CV_32S
+    };
+
+    // 原始格式数据区在文件中的偏移
+    static constexpr int kRawHeaderBytes = 64;
+
+    // 原始格式的文件头（kRawHeaderBytes 字节），供直接映射输出文件的写出方使用
+    static void encodeRawHeader(uchar* header, int rows, int cols, int numComponents, int depth);
+
+    // 编码到内存（追加到 out 之后）；labels 为 CV_16U 或 CV_32S
+    static bool encodeRle(const cv::Mat& labels, int numComponents, std::vector<uchar>& out);
+    static void encodeRle(const RunLengthLabels& rl, std::vector<uchar>& out, int depth = CV_32S);
+    static bool encodeRaw(const cv::Mat& labels, int numComponents, std::vector<uchar>& out);
+
+    // 逐行写文件
+    static bool writeRle(const std::string& path, const cv::Mat& labels, int numComponents);
+    static bool writeRle(const std::string& path, const RunLengthLabels& rl, int depth = CV_32S);
+    static bool writeRaw(const std::string& path, const cv::Mat& labels, int numComponents);
+
+    // 按文件头自动识别格式；以下读取函数对文件长度不足或标签超出 [0, numComponents] 的文件报格式错误
+    static bool readHeader(const std::string& path, Header& header);
+    // 解码到标记矩阵；尺寸与深度一致时复用 labels 的内存
+    static bool read(const std::string& path, cv::Mat& labels, int* numComponents = nullptr);
+    // 解码为游程（两种格式都支持）
+    static bool readRuns(const std::string& path, RunLengthLabels& rl);
+    // 直接累加连通域统计表（不含周长），不展开标记矩阵
+    static bool readStats(const std::string& path, ComponentStats& stats);
+};
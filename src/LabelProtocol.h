@@ -0,0 +1,90 @@
+﻿#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// 标记服务（cc_label --serve）与客户端之间的协议。
+// 控制消息为定长结构体，经 Unix 域套接字按到达顺序收发（同机通信，使用主机字节序）；
+// 图像与结果不经过套接字，而是放在客户端创建的共享内存环形缓冲区中：
+// 共 slots 个槽，每槽 slotBytes 字节，第 i 个槽位于偏移 i * slotBytes。
+// 槽内布局：输入帧（rows * cols 字节，CV_8UC1）从槽首开始，结果从 64 字节对齐的 outputOffset() 开始，
+// 依次为标记矩阵（需要时）与统计表（需要时），各段同样 64 字节对齐。
+namespace LabelProtocol {
+
+constexpr uint32_t kMagic = 0x4C424343;  // "CCBL"
+
+enum Kind : uint32_t {
+    kAttach = 1,      // 告知共享内存的名称与槽的规格
+    kLabel = 2,       // 标记某个槽中的帧
+    kQueryStats = 3,  // 查询服务端累计的请求延迟分位数
+};
+
+enum Flags : uint32_t {
+    kEightConnectivity = 1,
+    kWantLabels = 2,   // 写回标记矩阵
+    kWantStats = 4,    // 写回统计表
+    kLabels16 = 8,     // 标记矩阵使用 uint16（连通域数超过 65535 时退回 int32）
+};
+
+enum Status : int32_t {
+    kOk = 0,
+    kBadRequest = 1,   // 消息不合法、槽号越界或尚未 attach
+    kOverflow = 2,     // 槽内空间放不下结果
+    kFailed = 3,       // 服务端内部错误
+};
+
+// 客户端 -> 服务端
+struct Request {
+    uint32_t magic = kMagic;
+    uint32_t kind = kLabel;
+    uint64_t id = 0;
+    // kAttach
+    char shmName[64] = {};
+    uint32_t slots = 0;
+    uint64_t slotBytes = 0;
+    // kLabel
+    uint32_t slot = 0;
+    int32_t rows = 0, cols = 0;
+    int32_t threshold = -1;  // < 0：输入已是二值图（255 为前景）；否则为灰度图，服务端做 阈值化 + 3x3 闭运算
+    int32_t minSize = 0;
+    uint32_t flags = kWantLabels;
+};
+
+// 服务端 -> 客户端，与请求一一对应（同一连接上可能乱序返回，以 id 区分）
+struct Reply {
+    uint32_t magic = kMagic;
+    uint32_t kind = 0;
+    uint64_t id = 0;
+    int32_t status = kOk;
+    // kLabel
+    uint32_t slot = 0;
+    int32_t rows = 0, cols = 0;
+    int32_t numComponents = 0;
+    int32_t labelBytes = 0;     // 标记矩阵每个元素的字节数（2 或 4），未返回标记矩阵时为 0
+    uint64_t labelsOffset = 0;  // 相对槽首的偏移
+    uint64_t statsOffset = 0;
+    double queueMs = 0;         // 在服务端排队的时间
+    double serviceMs = 0;       // 预处理 + 标记 + 写回的时间
+    // kQueryStats
+    uint64_t served = 0;
+    double p50Ms = 0, p95Ms = 0, p99Ms = 0, maxMs = 0;
+};
+
+// 统计表的一项，第 i 项对应标签 i + 1
+struct StatsEntry {
+    int32_t label;
+    int32_t area;
+    int32_t left, top, width, height;
+    double cx, cy;
+};
+
+inline size_t alignUp(size_t n) { return (n + 63) & ~(size_t)63; }
+
+inline size_t outputOffset(int rows, int cols) { return alignUp((size_t)rows * cols); }
+
+// 在套接字上收发恰好 n 字节；对端关闭或出错时返回 false，不会触发 SIGPIPE
+bool sendAll(int fd, const void* data, size_t n);
+bool recvAll(int fd, void* data, size_t n);
+// 关闭该套接字上的 SIGPIPE（没有 MSG_NOSIGNAL 的平台需要）
+void disableSigpipe(int fd);
+
+}  // namespace LabelProtocol
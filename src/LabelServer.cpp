@@ -0,0 +1,326 @@
+﻿#include "LabelServer.h"
+#include "ThresholdClose.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <iomanip>
+#include <iostream>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace cv;
+using namespace std;
+using namespace LabelProtocol;
+
+struct LabelServer::Connection {
+    int fd = -1;
+    uchar* shm = nullptr;
+    size_t shmBytes = 0;
+    uint32_t slots = 0;
+    uint64_t slotBytes = 0;
+    mutex writeMutex;
+
+    ~Connection() {
+        if (shm) munmap(shm, shmBytes);
+        if (fd >= 0) close(fd);
+    }
+
+    bool send(const Reply& reply) {
+        lock_guard<mutex> lock(writeMutex);
+        return sendAll(fd, &reply, sizeof(reply));
+    }
+
+    // 映射客户端创建的共享内存；每个连接只允许 attach 一次。
+    // 槽大小须为 64 的倍数，槽内 int32 标记矩阵与统计表的视图才能对齐；
+    // 总大小 slots * slotBytes 溢出 size_t 的请求直接拒绝，否则回绕后的小映射能通过长度检查
+    bool attach(const Request& q) {
+        if (shm || q.slots == 0 || q.slotBytes == 0 || q.slotBytes % 64 != 0 || memchr(q.shmName, 0, sizeof(q.shmName)) == nullptr) return false;
+        if (q.slotBytes > SIZE_MAX / q.slots) return false;
+        const int shmFd = shm_open(q.shmName, O_RDWR, 0);
+        if (shmFd < 0) return false;
+        struct stat st;
+        const uint64_t bytes = (uint64_t)q.slots * q.slotBytes;
+        void* p = MAP_FAILED;
+        if (fstat(shmFd, &st) == 0 && (uint64_t)st.st_size >= bytes)
+            p = mmap(nullptr, (size_t)bytes, PROT_READ | PROT_WRITE, MAP_SHARED, shmFd, 0);
+        close(shmFd);
+        if (p == MAP_FAILED) return false;
+        shm = static_cast<uchar*>(p);
+        shmBytes = (size_t)bytes;
+        slots = q.slots;
+        slotBytes = q.slotBytes;
+        return true;
+    }
+};
+
+// 工作线程的常驻状态：检测器工作区、预处理缓冲与统计表在请求之间复用
+struct LabelServer::Worker {
+    unique_ptr<IComponentDetector> detectors[2];  // 4 邻域、8 邻域
+    ThresholdClose frontEnd;
+    Mat binary, labels;
+    ComponentStats stats;
+};
+
+static double elapsedMs(chrono::steady_clock::time_point from, chrono::steady_clock::time_point to) {
+    return chrono::duration<double, milli>(to - from).count();
+}
+
+LabelServer::LabelServer(const DetectorFactory& factory, const Options& options)
+    : m_factory(factory), m_options(options), m_queue(options.queueCapacity) {}
+
+LabelServer::~LabelServer() { stop(); }
+
+bool LabelServer::start() {
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    if (m_options.socketPath.empty() || m_options.socketPath.size() >= sizeof(addr.sun_path)) {
+        cerr << "套接字路径为空或过长: " << m_options.socketPath << endl;
+        return false;
+    }
+    strncpy(addr.sun_path, m_options.socketPath.c_str(), sizeof(addr.sun_path) - 1);
+
+    m_listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+    unlink(m_options.socketPath.c_str());
+    if (m_listenFd < 0 || ::bind(m_listenFd, (const sockaddr*)&addr, sizeof(addr)) != 0 || listen(m_listenFd, 64) != 0) {
+        cerr << "无法监听套接字: " << m_options.socketPath << " (" << strerror(errno) << ")" << endl;
+        if (m_listenFd >= 0) close(m_listenFd);
+        m_listenFd = -1;
+        return false;
+    }
+
+    const int numWorkers = max(m_options.workers, 1);
+    for (int w = 0; w < numWorkers; ++w) {
+        auto worker = make_unique<Worker>();
+        worker->detectors[0] = m_factory(false);
+        worker->detectors[1] = m_factory(true);
+        m_workers.push_back(std::move(worker));
+    }
+    for (auto& worker : m_workers) m_workerThreads.emplace_back([this, w = worker.get()] { workerLoop(*w); });
+    m_acceptThread = thread([this] { acceptLoop(); });
+    return true;
+}
+
+void LabelServer::stop() {
+    if (m_listenFd < 0 || m_stopping.exchange(true)) return;
+    m_acceptThread.join();
+    close(m_listenFd);
+    unlink(m_options.socketPath.c_str());
+
+    // 只关闭读方向：读线程退出，已排队请求的回复仍可发出
+    {
+        lock_guard<mutex> lock(m_connMutex);
+        for (auto& r : m_readers)
+            if (auto conn = r.conn.lock()) shutdown(conn->fd, SHUT_RD);
+    }
+    for (auto& r : m_readers) r.thread.join();
+    m_readers.clear();
+    m_queue.close();
+    for (auto& t : m_workerThreads) t.join();
+    m_listenFd = -1;
+}
+
+void LabelServer::acceptLoop() {
+    pollfd pfd{m_listenFd, POLLIN, 0};
+    while (!m_stopping) {
+        if (poll(&pfd, 1, 100) <= 0) continue;
+        const int fd = accept(m_listenFd, nullptr, nullptr);
+        if (fd < 0) continue;
+        disableSigpipe(fd);
+        auto conn = make_shared<Connection>();
+        conn->fd = fd;
+
+        lock_guard<mutex> lock(m_connMutex);
+        for (auto it = m_readers.begin(); it != m_readers.end();) {
+            if (!*it->done) {
+                ++it;
+                continue;
+            }
+            it->thread.join();
+            it = m_readers.erase(it);
+        }
+        auto done = make_shared<atomic<bool>>(false);
+        thread t([this, conn, done] {
+            readLoop(conn);
+            *done = true;
+        });
+        m_readers.push_back(Reader{std::move(t), done, conn});
+    }
+}
+
+void LabelServer::readLoop(shared_ptr<Connection> conn) {
+    Request q;
+    while (recvAll(conn->fd, &q, sizeof(q)) && q.magic == kMagic) {
+        Reply reply;
+        reply.kind = q.kind;
+        reply.id = q.id;
+        // 只在读线程上 attach，之后入队的请求经队列的互斥量看到已映射的共享内存；
+        // attach 之前的标记请求直接拒绝，不进入队列
+        if (q.kind == kLabel && conn->shm) {
+            if (!m_queue.push(Job{conn, q, chrono::steady_clock::now()})) break;
+            continue;
+        }
+        if (q.kind == kLabel) {
+            reply.slot = q.slot;
+            reply.status = kBadRequest;
+        } else if (q.kind == kAttach) {
+            reply.status = conn->attach(q) ? kOk : kBadRequest;
+        } else if (q.kind == kQueryStats) {
+            const Latency l = latency();
+            reply.served = l.served;
+            reply.p50Ms = l.p50Ms;
+            reply.p95Ms = l.p95Ms;
+            reply.p99Ms = l.p99Ms;
+            reply.maxMs = l.maxMs;
+        } else {
+            reply.status = kBadRequest;
+        }
+        if (!conn->send(reply)) break;
+    }
+}
+
+void LabelServer::workerLoop(Worker& worker) {
+    Job job;
+    while (m_queue.pop(job)) {
+        const auto started = chrono::steady_clock::now();
+        Reply reply;
+        reply.kind = kLabel;
+        reply.id = job.request.id;
+        reply.slot = job.request.slot;
+        reply.rows = job.request.rows;
+        reply.cols = job.request.cols;
+        process(worker, job, reply);
+        const auto finished = chrono::steady_clock::now();
+        reply.queueMs = elapsedMs(job.arrived, started);
+        reply.serviceMs = elapsedMs(started, finished);
+        job.conn->send(reply);
+        record(elapsedMs(job.arrived, finished), reply.queueMs);
+        job.conn.reset();
+    }
+}
+
+void LabelServer::process(Worker& worker, Job& job, Reply& reply) {
+    const Request& q = job.request;
+    const Connection& conn = *job.conn;
+    const size_t pixels = (size_t)max(q.rows, 0) * max(q.cols, 0);
+    if (!conn.shm || q.slot >= conn.slots || pixels == 0 || pixels > conn.slotBytes) {
+        reply.status = kBadRequest;
+        return;
+    }
+    uchar* slot = conn.shm + (size_t)q.slot * conn.slotBytes;
+    const size_t slotBytes = (size_t)conn.slotBytes;
+
+    // 输入帧直接引用共享内存，不做拷贝
+    const Mat input(q.rows, q.cols, CV_8UC1, slot);
+    const Mat* binary = &input;
+    if (q.threshold >= 0) {
+        worker.binary.create(q.rows, q.cols, CV_8UC1);
+        worker.frontEnd.run(input, q.threshold, [&](int y, const uchar* row) { memcpy(worker.binary.ptr(y), row, q.cols); });
+        binary = &worker.binary;
+    }
+
+    const bool wantLabels = q.flags & kWantLabels, wantStats = q.flags & kWantStats;
+    const int depth = q.flags & kLabels16 ? CV_16U : CV_32S;
+    const size_t out = outputOffset(q.rows, q.cols);
+    IComponentDetector& detector = *worker.detectors[(q.flags & kEightConnectivity) ? 1 : 0];
+    detector.setLabelDepth(depth);
+
+    // 需要标记矩阵时直接以共享内存为输出，检测器原地写入
+    Mat shared;
+    if (wantLabels) {
+        if (out + pixels * (depth == CV_16U ? 2 : 4) > slotBytes) {
+            reply.status = kOverflow;
+            return;
+        }
+        shared = Mat(q.rows, q.cols, depth, slot + out);
+    }
+    Mat& labels = wantLabels ? shared : worker.labels;
+    detector.detectInto(*binary, labels, q.minSize, wantStats ? &worker.stats : nullptr);
+    if (labels.empty()) {
+        reply.status = kFailed;
+        return;
+    }
+    const int n = detector.numComponents();
+    reply.numComponents = n;
+
+    size_t end = out;
+    if (wantLabels) {
+        // 连通域数超过 65535 时检测器退回 CV_32S 并另行分配，需要拷回共享内存
+        const size_t bytes = pixels * labels.elemSize();
+        if (labels.data != slot + out) {
+            if (out + bytes > slotBytes) {
+                reply.status = kOverflow;
+                return;
+            }
+            Mat dst(q.rows, q.cols, labels.type(), slot + out);
+            labels.copyTo(dst);
+        }
+        reply.labelBytes = (int32_t)labels.elemSize();
+        reply.labelsOffset = out;
+        end = alignUp(out + bytes);
+    }
+    if (wantStats) {
+        if (end + (size_t)n * sizeof(StatsEntry) > slotBytes) {
+            reply.status = kOverflow;
+            return;
+        }
+        StatsEntry* entries = reinterpret_cast<StatsEntry*>(slot + end);
+        const ComponentStats& s = worker.stats;
+        for (int l = 1; l <= n; ++l) {
+            const Rect box = s.bbox(l);
+            entries[l - 1] = StatsEntry{l, s.area[l], box.x, box.y, box.width, box.height, s.cx[l], s.cy[l]};
+        }
+        reply.statsOffset = end;
+    }
+}
+
+// 桶 0 为 1 微秒以内，桶 b 为 (1.05^(b-1), 1.05^b] 微秒
+static const double kBucketRatio = 1.05;
+
+static int latencyBucket(double ms, int numBuckets) {
+    const double us = ms * 1000.0;
+    if (us <= 1.0) return 0;
+    return min((int)ceil(log(us) / log(kBucketRatio)), numBuckets - 1);
+}
+
+void LabelServer::record(double totalMs, double queueMs) {
+    const int bucket = latencyBucket(totalMs, kLatencyBuckets);
+    lock_guard<mutex> lock(m_latencyMutex);
+    ++m_latencyHist[bucket];
+    ++m_served;
+    m_maxMs = max(m_maxMs, totalMs);
+    m_queueMsTotal += queueMs;
+}
+
+LabelServer::Latency LabelServer::latency() const {
+    lock_guard<mutex> lock(m_latencyMutex);
+    Latency l;
+    l.served = m_served;
+    if (m_served == 0) return l;
+    l.meanQueueMs = m_queueMsTotal / m_served;
+    l.maxMs = m_maxMs;
+    // 最近秩法：第 ceil(p% * n) 个样本所在桶的上界（不超过实测最大值）
+    auto percentile = [&](double p) {
+        const uint64_t rank = max<uint64_t>((uint64_t)ceil(p / 100.0 * m_served), 1);
+        uint64_t seen = 0;
+        for (int b = 0; b < kLatencyBuckets; ++b) {
+            seen += m_latencyHist[b];
+            if (seen >= rank) return min(pow(kBucketRatio, b) / 1000.0, m_maxMs);
+        }
+        return m_maxMs;
+    };
+    l.p50Ms = percentile(50);
+    l.p95Ms = percentile(95);
+    l.p99Ms = percentile(99);
+    return l;
+}
+
+void LabelServer::printLatency(const Latency& l) {
+    cout << "已处理 " << l.served << " 个请求，延迟 p50 " << fixed << setprecision(3) << l.p50Ms << " ms，p95 " << l.p95Ms
+         << " ms，p99 " << l.p99Ms << " ms，最大 " << l.maxMs << " ms，平均排队 " << l.meanQueueMs << " ms" << endl;
+}
@@ -0,0 +1,91 @@
+﻿#pragma once
+#include "BoundedQueue.h"
+#include "IComponentDetector.h"
+#include "LabelProtocol.h"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// 常驻标记服务：监听 Unix 域套接字，客户端经共享内存环形缓冲区传入帧（见 LabelProtocol），
+// 结果直接写回同一个槽，套接字上只有定长的控制消息。
+// 每个连接一个读线程，把请求放入共享的有界队列；固定数量的工作线程各自持有
+// 常驻的检测器（4/8 邻域各一个）与预处理缓冲，工作区在请求之间保持热状态。
+// 每个请求从到达到回复的延迟累计在固定大小的对数直方图中（相邻桶相差 5%），长期运行内存不增长，
+// 可随时查询分位数（取所在桶的上界，相对误差不超过 5%）。仅在 POSIX 平台提供。
+class LabelServer {
+public:
+    // 每个工作线程为每种邻域各创建一个检测器实例
+    using DetectorFactory = std::function<std::unique_ptr<IComponentDetector>(bool eight)>;
+
+    struct Options {
+        std::string socketPath;
+        int workers = 2;
+        size_t queueCapacity = 64;
+    };
+
+    struct Latency {
+        size_t served = 0;
+        double p50Ms = 0, p95Ms = 0, p99Ms = 0, maxMs = 0;
+        double meanQueueMs = 0;
+    };
+
+    LabelServer(const DetectorFactory& factory, const Options& options);
+    ~LabelServer();
+    LabelServer(const LabelServer&) = delete;
+    LabelServer& operator=(const LabelServer&) = delete;
+
+    // 绑定套接字并启动各线程；套接字路径已存在时先删除
+    bool start();
+    // 停止接受连接、处理完队列中的请求后返回
+    void stop();
+
+    Latency latency() const;
+    static void printLatency(const Latency& latency);
+
+private:
+    struct Connection;
+    struct Job {
+        std::shared_ptr<Connection> conn;
+        LabelProtocol::Request request;
+        std::chrono::steady_clock::time_point arrived;
+    };
+    struct Worker;
+
+    void acceptLoop();
+    void readLoop(std::shared_ptr<Connection> conn);
+    void workerLoop(Worker& worker);
+    void process(Worker& worker, Job& job, LabelProtocol::Reply& reply);
+    void record(double totalMs, double queueMs);
+
+    DetectorFactory m_factory;
+    Options m_options;
+    int m_listenFd = -1;
+    std::atomic<bool> m_stopping{false};
+
+    BoundedQueue<Job> m_queue;
+    std::thread m_acceptThread;
+    std::vector<std::thread> m_workerThreads;
+    std::vector<std::unique_ptr<Worker>> m_workers;
+
+    // 读线程结束后置 done，由接受线程回收
+    struct Reader {
+        std::thread thread;
+        std::shared_ptr<std::atomic<bool>> done;
+        std::weak_ptr<Connection> conn;
+    };
+    std::mutex m_connMutex;
+    std::vector<Reader> m_readers;
+
+    static constexpr int kLatencyBuckets = 400;  // 覆盖 1 微秒到约 290 秒
+    mutable std::mutex m_latencyMutex;
+    std::array<uint64_t, kLatencyBuckets> m_latencyHist{};
+    uint64_t m_served = 0;
+    double m_maxMs = 0;
+    double m_queueMsTotal = 0;
+};
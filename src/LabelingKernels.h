@@ -0,0 +1,67 @@
+﻿#pragma once
+#include <opencv2/opencv.hpp>
+#include <cstdint>
+#include <type_traits>
+
+// 编译期特化的标记内核公共部分。
+// 邻域（4/8）、输出标签类型（uint16/int32）与是否按 minSize 过滤都作为模板参数，
+// 热循环内用 if constexpr 展开，不再有运行时分支；检测器在入口处用 dispatch* 一次性选定实例。
+namespace LabelingKernels {
+
+template <bool V>
+using Flag = std::integral_constant<bool, V>;
+
+template <typename LabelT>
+struct LabelTag {
+    using type = LabelT;
+};
+
+// 标签类型对应的 OpenCV 深度
+template <typename LabelT>
+constexpr int labelDepthOf() {
+    static_assert(std::is_same<LabelT, uint16_t>::value || std::is_same<LabelT, int>::value, "unsupported label type");
+    return std::is_same<LabelT, uint16_t>::value ? CV_16U : CV_32S;
+}
+
+// 按邻域与是否过滤分派：f(Flag<Eight>, Flag<Filter>)
+template <typename F>
+void dispatch(bool eight, bool filter, F&& f) {
+    if (eight) {
+        if (filter) f(Flag<true>(), Flag<true>());
+        else f(Flag<true>(), Flag<false>());
+    } else {
+        if (filter) f(Flag<false>(), Flag<true>());
+        else f(Flag<false>(), Flag<false>());
+    }
+}
+
+// 按输出深度分派：CV_16U -> f(LabelTag<uint16_t>)，其余 -> f(LabelTag<int>)
+template <typename F>
+void dispatchLabelType(int depth, F&& f) {
+    if (depth == CV_16U) f(LabelTag<uint16_t>());
+    else f(LabelTag<int>());
+}
+
+// 依次访问 (x, y) 在图像内的邻居，回调参数为 (dy, nx)，dy ∈ {-1, 0, 1}；
+// 调用方据 dy 选取预先取好的行指针，避免逐像素的 Mat::at 地址计算
+template <bool Eight, typename F>
+inline void forEachNeighbor(int x, int y, int rows, int cols, F&& f) {
+    const bool l = x > 0, r = x + 1 < cols, u = y > 0, d = y + 1 < rows;
+    if constexpr (Eight) {
+        if (u && l) f(-1, x - 1);
+        if (u) f(-1, x);
+        if (u && r) f(-1, x + 1);
+        if (l) f(0, x - 1);
+        if (r) f(0, x + 1);
+        if (d && l) f(1, x - 1);
+        if (d) f(1, x);
+        if (d && r) f(1, x + 1);
+    } else {
+        if (u) f(-1, x);
+        if (l) f(0, x - 1);
+        if (r) f(0, x + 1);
+        if (d) f(1, x);
+    }
+}
+
+}  // namespace LabelingKernels
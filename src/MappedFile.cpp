@@ -0,0 +1,65 @@
+﻿#include "MappedFile.h"
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+bool MappedFile::open(const string& path, Mode mode, uint64_t size) {
+    close();
+    m_mode = mode;
+    if (mode == kRead) {
+        m_fd = ::open(path.c_str(), O_RDONLY);
+        struct stat st;
+        if (m_fd < 0 || fstat(m_fd, &st) != 0) {
+            cerr << "无法读取文件: " << path << endl;
+            close();
+            return false;
+        }
+        m_size = (uint64_t)st.st_size;
+        return true;
+    }
+    m_fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (m_fd < 0 || ftruncate(m_fd, (off_t)size) != 0) {
+        cerr << "无法写入文件: " << path << " (" << strerror(errno) << ")" << endl;
+        close();
+        return false;
+    }
+    m_size = size;
+    return true;
+}
+
+void MappedFile::close() {
+    unmap();
+    if (m_fd >= 0) ::close(m_fd);
+    m_fd = -1;
+    m_size = 0;
+}
+
+unsigned char* MappedFile::map(uint64_t offset, size_t length, bool sequential) {
+    unmap();
+    if (m_fd < 0 || length == 0 || offset + length > m_size) return nullptr;
+    static const uint64_t pageSize = (uint64_t)sysconf(_SC_PAGESIZE);
+    const uint64_t aligned = offset / pageSize * pageSize;
+    const size_t delta = (size_t)(offset - aligned);
+    const int prot = m_mode == kRead ? PROT_READ : PROT_READ | PROT_WRITE;
+    void* p = mmap(nullptr, length + delta, prot, MAP_SHARED, m_fd, (off_t)aligned);
+    if (p == MAP_FAILED) {
+        cerr << "内存映射失败 (" << strerror(errno) << ")" << endl;
+        return nullptr;
+    }
+    if (sequential) madvise(p, length + delta, MADV_SEQUENTIAL);
+    m_base = p;
+    m_length = length + delta;
+    return static_cast<unsigned char*>(p) + delta;
+}
+
+void MappedFile::unmap() {
+    if (m_base) munmap(m_base, m_length);
+    m_base = nullptr;
+    m_length = 0;
+}
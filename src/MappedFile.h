@@ -0,0 +1,34 @@
+﻿#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// 文件的内存映射窗口。同一时刻只映射一段 [offset, offset + length)，
+// 换窗口时先解除旧映射，因此常驻内存只取决于窗口大小而与文件大小无关；
+// 写入的页面在解除映射后由内核回写。仅在 POSIX 平台提供。
+class MappedFile {
+public:
+    enum Mode { kRead, kReadWrite };
+
+    MappedFile() = default;
+    ~MappedFile() { close(); }
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // kReadWrite 时创建（或截断）文件并设为 size 字节
+    bool open(const std::string& path, Mode mode, uint64_t size = 0);
+    void close();
+    bool isOpen() const { return m_fd >= 0; }
+    uint64_t size() const { return m_size; }
+
+    // 映射一个新窗口，返回指向 offset 处的指针（offset 不必按页对齐）；失败返回 nullptr
+    unsigned char* map(uint64_t offset, size_t length, bool sequential = true);
+    void unmap();
+
+private:
+    int m_fd = -1;
+    Mode m_mode = kRead;
+    uint64_t m_size = 0;
+    void* m_base = nullptr;
+    size_t m_length = 0;
+};
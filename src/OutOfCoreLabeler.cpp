@@ -0,0 +1,366 @@
+﻿#include "OutOfCoreLabeler.h"
+#include "LabelMapIO.h"
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+
+using namespace cv;
+using namespace std;
+
+// 块带等价表每个节点的最坏开销：父指针、面积、底行记号、两张去向表、第二遍的解析表
+static const size_t kBytesPerNode = 32;
+
+static double msSince(chrono::steady_clock::time_point start) {
+    return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+bool OutOfCoreLabeler::probePgm(const string& path, Input& input) {
+    ifstream is(path, ios::binary);
+    if (!is) {
+        cerr << "无法读取文件: " << path << endl;
+        return false;
+    }
+    // 文件头各字段以空白分隔，可夹带 # 注释；最后一个字段后恰有一个空白字符
+    auto token = [&](string& s) {
+        s.clear();
+        char c;
+        while (is.get(c)) {
+            if (c == '#' && s.empty()) {
+                string comment;
+                getline(is, comment);
+            } else if (isspace((unsigned char)c)) {
+                if (!s.empty()) return true;
+            } else {
+                s += c;
+            }
+        }
+        return false;
+    };
+    string magic, width, height, maxval;
+    if (!token(magic) || magic != "P5" || !token(width) || !token(height) || !token(maxval) || atoi(maxval.c_str()) > 255) {
+        cerr << "仅支持 8 位二进制 PGM（P5）: " << path << endl;
+        return false;
+    }
+    input.path = path;
+    input.cols = atoi(width.c_str());
+    input.rows = atoi(height.c_str());
+    input.offset = (uint64_t)is.tellg();
+    input.tileRows = input.tileCols = 0;
+    return true;
+}
+
+void OutOfCoreLabeler::setEightConnectivity(bool enabled) {
+    m_useEightConnectivity = enabled;
+    m_bbdt.setEightConnectivity(enabled);
+}
+
+void OutOfCoreLabeler::setTileSize(int rows, int cols) {
+    m_tileRows = max(rows, 0);
+    m_tileCols = max(cols, 0);
+}
+
+size_t OutOfCoreLabeler::estimateBytes(int cols, int tileRows, int tileCols) const {
+    // 映射窗口每像素输入 1 字节 + 输出 4 字节（另含上方一行）；块缓冲每像素约 16 字节（二值副本、块内标签与检测器工作区）；
+    // 等价表节点数不超过块带四周与块间竖直边界上的像素数
+    const size_t tilesX = ((size_t)cols + tileCols - 1) / tileCols;
+    const size_t window = (size_t)cols * tileRows * 5 + (size_t)cols * 4;
+    const size_t tile = (size_t)tileRows * tileCols * 16;
+    const size_t nodes = (size_t)cols * 2 + (size_t)tileRows * tilesX * 2;
+    return window + tile + nodes * kBytesPerNode;
+}
+
+void OutOfCoreLabeler::chooseTileSize(const Input& input, int& tileRows, int& tileCols) const {
+    // 一半预算给块带的映射窗口，四分之一给块缓冲，余下留给块带等价表；放不下时减半块带高度
+    auto pickCols = [&](int r) {
+        const size_t quarter = m_budget / 4;
+        const int c = m_tileCols > 0 ? m_tileCols : (int)min<size_t>(max<size_t>(quarter / ((size_t)r * 16), 64), INT_MAX);
+        return min(c, input.cols);
+    };
+    tileRows = m_tileRows > 0 ? m_tileRows
+                              : (int)min<size_t>(max<size_t>(m_budget / 2 / ((size_t)input.cols * 5), 16), INT_MAX);
+    tileRows = min(tileRows, input.rows);
+    tileCols = pickCols(tileRows);
+    while (m_tileRows <= 0 && tileRows > 16 && estimateBytes(input.cols, tileRows, tileCols) > m_budget) {
+        tileRows = max(tileRows / 2, 16);
+        tileCols = pickCols(tileRows);
+    }
+}
+
+bool OutOfCoreLabeler::labelTile(const Mat& tile, uint32_t* out, size_t outStride, bool top, bool bottom, bool left, bool right) {
+    const Mat* binary = &tile;
+    if (m_threshold >= 0) {
+        threshold(tile, m_binary, m_threshold, 255, THRESH_BINARY);
+        binary = &m_binary;
+    }
+    const bool filter = m_minSize > 0;
+    m_bbdt.detectInto(*binary, m_local, 0, filter ? &m_stats : nullptr);
+    const int n = m_bbdt.numComponents();
+    const int rows = tile.rows, cols = tile.cols;
+
+    // 接触“有相邻块的边”的连通域可能跨块，先做记号；接触块带底行的另记最低位，用于判断是否延续到下一块带
+    m_map.assign(n + 1, 0);
+    auto markRow = [&](int y, uint32_t mark) {
+        const int* l = m_local.ptr<int>(y);
+        for (int x = 0; x < cols; ++x) m_map[l[x]] |= mark;
+    };
+    auto markCol = [&](int x) {
+        for (int y = 0; y < rows; ++y) m_map[m_local.ptr<int>(y)[x]] |= kBorderFlag;
+    };
+    if (top) markRow(0, kBorderFlag);
+    if (bottom) markRow(rows - 1, kBorderFlag | 1u);
+    if (left) markCol(0);
+    if (right) markCol(cols - 1);
+    m_map[0] = 0;
+
+    // 跨块的分配临时编号；块内的直接给最终标签（面积不足的置为背景）
+    bool border = false;
+    for (int l = 1; l <= n; ++l) {
+        if (m_map[l] & kBorderFlag) {
+            m_touchesBottom.push_back((char)(m_map[l] & 1u));
+            m_map[l] = kBorderFlag | (uint32_t)m_equiv.newLabel();
+            if (filter) m_area.push_back(m_stats.area[l]);
+            border = true;
+        } else {
+            m_map[l] = (!filter || m_stats.area[l] >= m_minSize) ? allocateLabel() : 0;
+        }
+    }
+    for (int y = 0; y < rows; ++y) {
+        const int* src = m_local.ptr<int>(y);
+        uint32_t* dst = out + y * outStride;
+        for (int x = 0; x < cols; ++x) dst[x] = m_map[src[x]];
+    }
+    return border;
+}
+
+uint32_t OutOfCoreLabeler::allocateLabel() {
+    // 最终标签不能用到 kBorderFlag 位；用尽时记下溢出，由 run 报错终止
+    if (m_nextLabel == INT_MAX) {
+        m_labelOverflow = true;
+        return 0;
+    }
+    return (uint32_t)++m_nextLabel;
+}
+
+void OutOfCoreLabeler::mergeBorders(const uint32_t* out, size_t outStride, int rows, int cols, bool top, bool left,
+                                    bool hasLeftOfTop, bool hasRightOfTop) {
+    // 边界两侧的前景像素都带临时编号，背景为 0；上一块带的像素经其去向表换成延续编号
+    auto unite = [&](uint32_t a, uint32_t b) {
+        if (b) m_equiv.merge((int)(a & ~kBorderFlag), (int)(b & ~kBorderFlag));
+    };
+    auto uniteUp = [&](uint32_t a, uint32_t b) {
+        if (b) m_equiv.merge((int)(a & ~kBorderFlag), (int)(m_prevTable[b & ~kBorderFlag] & ~kBorderFlag));
+    };
+    const bool eight = m_useEightConnectivity;
+    if (top) {
+        const uint32_t* cur = out;
+        const uint32_t* up = out - outStride;
+        for (int x = 0; x < cols; ++x) {
+            if (!cur[x]) continue;
+            uniteUp(cur[x], up[x]);
+            if (eight && (x > 0 || hasLeftOfTop)) uniteUp(cur[x], up[x - 1]);
+            if (eight && (x + 1 < cols || hasRightOfTop)) uniteUp(cur[x], up[x + 1]);
+        }
+    }
+    if (left) {
+        for (int y = 0; y < rows; ++y) {
+            const uint32_t* cur = out + y * outStride;
+            if (!cur[0]) continue;
+            unite(cur[0], cur[-1]);
+            if (eight && y > 0) unite(cur[0], cur[-1 - (ptrdiff_t)outStride]);
+            if (eight && y == 0 && top) uniteUp(cur[0], cur[-1 - (ptrdiff_t)outStride]);
+            if (eight && y + 1 < rows) unite(cur[0], cur[outStride - 1]);
+        }
+    }
+}
+
+void OutOfCoreLabeler::finishBand(bool lastBand, ostream& side, BandTable& table) {
+    vector<int>& parent = m_equiv.parent;
+    const bool filter = m_minSize > 0;
+    const size_t numNodes = parent.size();
+    m_equiv.flatten();
+    for (size_t l = 1; l < numNodes; ++l) {
+        const int root = parent[l];
+        if (root == (int)l) continue;
+        if (filter) m_area[root] += m_area[l];
+        m_touchesBottom[root] |= m_touchesBottom[l];
+    }
+
+    // 根总是先于同集合的其他节点出现：仍接触底行的集合分配新的延续编号，其余集合结束并分配最终标签
+    vector<int64_t> carriedArea(1, 0);
+    m_table.assign(numNodes, 0);
+    for (size_t l = 1; l < numNodes; ++l) {
+        const int root = parent[l];
+        if (root != (int)l) {
+            m_table[l] = m_table[root];
+        } else if (!lastBand && m_touchesBottom[l]) {
+            m_table[l] = kBorderFlag | (uint32_t)carriedArea.size();
+            if (filter) carriedArea.push_back(m_area[l]);
+            else carriedArea.push_back(0);
+        } else {
+            m_table[l] = (!filter || m_area[l] >= m_minSize) ? allocateLabel() : 0;
+        }
+    }
+    table.offset = (uint64_t)side.tellp();
+    table.numNodes = numNodes - 1;
+    table.numCarried = (size_t)m_numCarried;
+    side.write(reinterpret_cast<const char*>(m_table.data() + 1), (streamsize)(table.numNodes * sizeof(uint32_t)));
+    m_report.borderLabels += (int)(table.numNodes - table.numCarried);
+    m_report.workingBytes = max(m_report.workingBytes, workingBytes());
+
+    // 下一块带的节点从延续编号开始
+    m_prevTable.swap(m_table);
+    m_numCarried = (int)carriedArea.size() - 1;
+    m_report.peakCarried = max(m_report.peakCarried, m_numCarried);
+    m_equiv.reset(numNodes);
+    for (int c = 0; c < m_numCarried; ++c) m_equiv.newLabel();
+    m_touchesBottom.assign(m_numCarried + 1, 0);
+    if (filter) m_area.swap(carriedArea);
+}
+
+size_t OutOfCoreLabeler::workingBytes() const {
+    return m_binary.total() + m_local.total() * m_local.elemSize() + m_map.capacity() * sizeof(uint32_t) +
+           m_equiv.parent.capacity() * sizeof(int) + m_area.capacity() * sizeof(int64_t) + m_touchesBottom.capacity() +
+           (m_prevTable.capacity() + m_table.capacity()) * sizeof(uint32_t);
+}
+
+bool OutOfCoreLabeler::run(const Input& input, const string& outputPath) {
+    m_report = Report();
+    const int rows = input.rows, cols = input.cols;
+    const bool tiled = input.tileRows > 0 && input.tileCols > 0;
+    if (rows <= 0 || cols <= 0) {
+        cerr << "图像尺寸无效: " << rows << "x" << cols << endl;
+        return false;
+    }
+    int tileRows, tileCols;
+    if (tiled) {
+        tileRows = input.tileRows;
+        tileCols = input.tileCols;
+    } else {
+        chooseTileSize(input, tileRows, tileCols);
+    }
+    const size_t estimate = estimateBytes(cols, min(tileRows, rows), min(tileCols, cols));
+    if (estimate > m_budget)
+        cerr << "警告: 块尺寸 " << tileRows << "x" << tileCols << " 下预计常驻内存 " << (estimate >> 10) << " KB，超出预算 "
+             << (m_budget >> 10) << " KB" << endl;
+    const int tilesY = (rows + tileRows - 1) / tileRows, tilesX = (cols + tileCols - 1) / tileCols;
+    const uint64_t tileBytes = (uint64_t)tileRows * tileCols;
+    const uint64_t dataBytes = tiled ? tileBytes * tilesX * tilesY : (uint64_t)rows * cols;
+
+    MappedFile in, out;
+    if (!in.open(input.path, MappedFile::kRead)) return false;
+    if (in.size() < input.offset + dataBytes) {
+        cerr << "输入文件小于给定尺寸: " << input.path << endl;
+        return false;
+    }
+    const size_t outStride = (size_t)cols;
+    const uint64_t rowBytes = (uint64_t)cols * sizeof(uint32_t);
+    if (!out.open(outputPath, MappedFile::kReadWrite, LabelMapIO::kRawHeaderBytes + rowBytes * rows)) return false;
+
+    // 各块带的去向表写入旁路文件，结束时删除
+    const string sidePath = outputPath + ".eq";
+    struct SideFile {
+        const string& path;
+        ~SideFile() { std::remove(path.c_str()); }
+    } sideGuard{sidePath};
+    ofstream side(sidePath, ios::binary | ios::trunc);
+    if (!side) {
+        cerr << "无法写入文件: " << sidePath << endl;
+        return false;
+    }
+
+    // 第一遍：按分块顺序标记，块带的输出窗口多映射上一行，用于与上方块合并
+    auto start = chrono::steady_clock::now();
+    m_equiv.reset();
+    m_numCarried = 0;
+    m_area.assign(1, 0);
+    m_touchesBottom.assign(1, 0);
+    m_prevTable.clear();
+    m_nextLabel = 0;
+    m_labelOverflow = false;
+    vector<BandTable> tables(tilesY);
+    for (int ty = 0; ty < tilesY; ++ty) {
+        const int y0 = ty * tileRows, bandRows = min(tileRows, rows - y0);
+        const int halo = y0 > 0 ? 1 : 0;
+        const uint64_t inOffset = input.offset + (tiled ? tileBytes * tilesX * ty : (uint64_t)y0 * cols);
+        const size_t inBytes = tiled ? (size_t)(tileBytes * tilesX) : (size_t)bandRows * cols;
+        const size_t outBytes = (size_t)((bandRows + halo) * rowBytes);
+        const uchar* inBase = in.map(inOffset, inBytes);
+        uchar* outBase = out.map(LabelMapIO::kRawHeaderBytes + (y0 - halo) * rowBytes, outBytes);
+        if (!inBase || !outBase) return false;
+        uint32_t* bandOut = reinterpret_cast<uint32_t*>(outBase) + halo * outStride;
+
+        for (int tx = 0; tx < tilesX; ++tx) {
+            const int x0 = tx * tileCols, width = min(tileCols, cols - x0);
+            const Mat tile = tiled ? Mat(bandRows, width, CV_8UC1, (void*)(inBase + tileBytes * tx), (size_t)tileCols)
+                                   : Mat(bandRows, width, CV_8UC1, (void*)(inBase + x0), (size_t)cols);
+            const bool top = ty > 0, left = tx > 0;
+            if (!labelTile(tile, bandOut + x0, outStride, top, ty + 1 < tilesY, left, tx + 1 < tilesX)) continue;
+            mergeBorders(bandOut + x0, outStride, bandRows, width, top, left, x0 > 0, x0 + width < cols);
+        }
+        finishBand(ty + 1 == tilesY, side, tables[ty]);
+        if (m_labelOverflow) {
+            cerr << "连通域数超出 int32 标记图的上限 " << INT_MAX << endl;
+            return false;
+        }
+        m_report.windowBytes = max(m_report.windowBytes, inBytes + outBytes);
+    }
+    in.close();
+    side.close();
+    if (!side) {
+        cerr << "无法写入文件: " << sidePath << endl;
+        return false;
+    }
+    m_report.pass1Ms = msSince(start);
+
+    // 第二遍：自下而上，用下一块带解析出的 延续编号 -> 最终标签 表解析本块带的去向表，只改写含临时编号的块带
+    start = chrono::steady_clock::now();
+    MappedFile sideIn;
+    if (!sideIn.open(sidePath, MappedFile::kRead)) return false;
+    vector<uint32_t> carried(1, 0), resolved(1, 0);
+    for (int ty = tilesY - 1; ty >= 0; --ty) {
+        const BandTable& t = tables[ty];
+        if (t.numNodes == 0) {
+            carried.assign(1, 0);
+            continue;
+        }
+        const uint32_t* entries = reinterpret_cast<const uint32_t*>(sideIn.map(t.offset, t.numNodes * sizeof(uint32_t)));
+        if (!entries) return false;
+        resolved.resize(t.numNodes + 1);
+        for (size_t i = 0; i < t.numNodes; ++i) {
+            const uint32_t v = entries[i];
+            resolved[i + 1] = (v & kBorderFlag) ? carried[v & ~kBorderFlag] : v;
+        }
+        m_report.workingBytes = max(m_report.workingBytes, workingBytes() + (carried.capacity() + resolved.capacity()) * sizeof(uint32_t));
+        if (t.numNodes > t.numCarried) {
+            const int y0 = ty * tileRows, bandRows = min(tileRows, rows - y0);
+            uchar* base = out.map(LabelMapIO::kRawHeaderBytes + y0 * rowBytes, (size_t)(bandRows * rowBytes));
+            if (!base) return false;
+            uint32_t* p = reinterpret_cast<uint32_t*>(base);
+            const size_t count = (size_t)bandRows * cols;
+            for (size_t i = 0; i < count; ++i)
+                if (p[i] & kBorderFlag) p[i] = resolved[p[i] & ~kBorderFlag];
+        }
+        // 本块带的前 numCarried 个节点就是上一块带的延续编号
+        carried.assign(resolved.begin(), resolved.begin() + t.numCarried + 1);
+    }
+    sideIn.close();
+    uchar* header = out.map(0, LabelMapIO::kRawHeaderBytes, false);
+    if (!header) return false;
+    LabelMapIO::encodeRawHeader(header, rows, cols, m_nextLabel, CV_32S);
+    out.close();
+    m_report.pass2Ms = msSince(start);
+
+    m_report.numComponents = m_nextLabel;
+    m_report.tileRows = tileRows;
+    m_report.tileCols = tileCols;
+    if (m_report.windowBytes + m_report.workingBytes > m_budget) {
+        m_report.overBudget = true;
+        cerr << "警告: 常驻内存峰值 " << ((m_report.windowBytes + m_report.workingBytes) >> 10) << " KB 超出预算 "
+             << (m_budget >> 10) << " KB" << endl;
+    }
+    return true;
+}
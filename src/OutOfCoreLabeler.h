@@ -0,0 +1,105 @@
+﻿#pragma once
+#include "ConnectedComponentsBBDT.h"
+#include "LabelEquivalence.h"
+#include "MappedFile.h"
+#include <opencv2/opencv.hpp>
+#include <string>
+#include <vector>
+
+// 超大图像的外存分块标记：输入（PGM P5、无文件头的 8 位原始数据或分块存储的原始数据）与输出标记图
+// 都经内存映射按块带（一行块）访问，整幅图像与标记矩阵都不需要放进内存。
+// 第一遍自上而下逐块带、块带内逐块用 BBDT 标记：只在块内部的连通域立即得到最终标签；
+// 接触块边界的连通域写入最高位置 1 的块带内临时编号，并在边界上与已写出的上方、左侧相邻块合并。
+// 每个块带结束时，仍接触块带底行的集合延续到下一块带（延续编号），其余集合就此结束并分配最终标签；
+// 临时编号与上一块带延续编号的去向（最终标签或新的延续编号）写入旁路文件，内存中不保留。
+// 第二遍自下而上逐块带读取旁路文件，把延续编号逐层解析为最终标签，并改写含临时编号的块带。
+// 因此等价表只含当前块带的临时编号与 O(宽度) 个延续编号，与图像高度无关。
+// 输出为 LabelMapIO 的原始格式（int32），可直接 mmap 或用 LabelMapIO 读取。
+// 标签编号连续，按连通域结束的先后分配（块内连通域在所在块处理时，跨块连通域在最后一个块带结束时），
+// 与整幅标记的光栅顺序不同。输出为 int32 且最高位留给临时编号，连通域数上限为 2^31-1，超出时报错失败。
+// 常驻内存 = 块带的输入与输出映射窗口 + 一个块的标记缓冲 + 块带等价表，块尺寸按预算选取；
+// 实际峰值超出预算时给出警告。仅在 POSIX 平台提供。
+class OutOfCoreLabeler {
+public:
+    struct Input {
+        std::string path;
+        int rows = 0, cols = 0;
+        uint64_t offset = 0;             // 像素数据在文件中的偏移
+        int tileRows = 0, tileCols = 0;  // 大于 0 表示分块存储：各块按光栅顺序依次存放，每块 tileRows x tileCols 字节（边缘块补齐）
+    };
+
+    struct Report {
+        int numComponents = 0;
+        int tileRows = 0, tileCols = 0;
+        int borderLabels = 0;     // 各块带临时编号数之和
+        int peakCarried = 0;      // 跨块带延续的集合数峰值
+        size_t windowBytes = 0;   // 映射窗口峰值
+        size_t workingBytes = 0;  // 块缓冲与等价表峰值
+        bool overBudget = false;  // 窗口与工作内存之和超出预算
+        double pass1Ms = 0, pass2Ms = 0;
+    };
+
+    // 解析 PGM（P5，8 位）文件头，填入尺寸与数据偏移
+    static bool probePgm(const std::string& path, Input& input);
+
+    // 选择4邻域或8邻域，默认4邻域
+    void setEightConnectivity(bool enabled);
+    // 面积小于 minSize 的连通域置为背景
+    void setMinSize(int minSize) { m_minSize = minSize; }
+    // 前景判定为 像素值 > threshold；threshold < 0 表示输入已是 0/255 二值图，直接引用映射内存
+    void setThreshold(int threshold) { m_threshold = threshold; }
+    // 常驻内存预算（字节），用于选取块尺寸；分块存储的输入沿用其自身的块尺寸
+    void setMemoryBudget(size_t bytes) { m_budget = bytes; }
+    // 手动指定块尺寸，0 表示按预算选取
+    void setTileSize(int rows, int cols);
+
+    bool run(const Input& input, const std::string& outputPath);
+    const Report& report() const { return m_report; }
+
+private:
+    // 用于标记临时编号（像素值）与延续编号（去向表）的最高位
+    static constexpr uint32_t kBorderFlag = 0x80000000u;
+
+    // 一个块带的去向表在旁路文件中的位置：按节点顺序存放，前 numCarried 项为上一块带的延续编号
+    struct BandTable {
+        uint64_t offset = 0;
+        size_t numNodes = 0, numCarried = 0;
+    };
+
+    // 按预算选取块尺寸：一半给映射窗口，四分之一给块缓冲，四分之一给块带等价表（按最坏情况估计）
+    void chooseTileSize(const Input& input, int& tileRows, int& tileCols) const;
+    size_t estimateBytes(int cols, int tileRows, int tileCols) const;
+    // 标记一个块并写入输出窗口，返回是否产生了临时编号
+    bool labelTile(const cv::Mat& tile, uint32_t* out, size_t outStride, bool top, bool bottom, bool left, bool right);
+    // 块与上方、左侧已写出区域的边界合并；out 指向块左上角，上一行与左一列均已写出
+    void mergeBorders(const uint32_t* out, size_t outStride, int rows, int cols, bool top, bool left, bool hasLeftOfTop,
+                      bool hasRightOfTop);
+    // 块带结束：结算不再延续的集合，写出去向表，准备下一块带的延续编号
+    void finishBand(bool lastBand, std::ostream& side, BandTable& table);
+    size_t workingBytes() const;
+    // 分配下一个最终标签；已达上限时置 m_labelOverflow 并返回 0
+    uint32_t allocateLabel();
+
+    ConnectedComponentsBBDT m_bbdt;
+    cv::Mat m_binary, m_local;
+    ComponentStats m_stats;
+    std::vector<uint32_t> m_map;  // 块内标签 -> 输出值
+
+    // 当前块带的等价表：节点 1..m_numCarried 为上一块带延续下来的集合，其后为本块带的临时编号；
+    // 临时编号像素的值即 kBorderFlag | 节点号
+    LabelEquivalence m_equiv;
+    int m_numCarried = 0;
+    std::vector<int64_t> m_area;         // 各节点面积，仅在 minSize > 0 时累计
+    std::vector<char> m_touchesBottom;   // 各节点是否接触块带底行
+    std::vector<uint32_t> m_prevTable;   // 上一块带的去向表，用于把上方像素换成延续编号
+    std::vector<uint32_t> m_table;       // 本块带的去向表
+    int m_nextLabel = 0;
+    bool m_labelOverflow = false;
+
+    size_t m_budget = (size_t)256 << 20;
+    int m_tileRows = 0, m_tileCols = 0;
+    int m_threshold = 127;
+    int m_minSize = 0;
+    bool m_useEightConnectivity = false;
+    Report m_report;
+};
@@ -0,0 +1,147 @@
+﻿#include "PackedBinaryMask.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CC_PACK_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+using namespace cv;
+using namespace std;
+
+namespace {
+
+inline int ctz64(uint64_t v) {
+#if defined(_MSC_VER)
+    unsigned long idx;
+    _BitScanForward64(&idx, v);
+    return (int)idx;
+#else
+    return __builtin_ctzll(v);
+#endif
+}
+
+inline int popcount64(uint64_t v) {
+#if defined(_MSC_VER)
+    return (int)__popcnt64(v);
+#else
+    return __builtin_popcountll(v);
+#endif
+}
+
+// 打包一行：每像素 >= lo 则置位。无符号比较借助 max(v, lo) == v 实现
+void packRow(const uchar* src, int cols, uchar lo, uint64_t* dst) {
+    int x = 0, w = 0;
+#if defined(__AVX2__)
+    const __m256i vlo = _mm256_set1_epi8((char)lo);
+    for (; x + 64 <= cols; x += 64, ++w) {
+        __m256i a = _mm256_loadu_si256((const __m256i*)(src + x));
+        __m256i b = _mm256_loadu_si256((const __m256i*)(src + x + 32));
+        uint32_t ma = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_max_epu8(a, vlo), a));
+        uint32_t mb = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_max_epu8(b, vlo), b));
+        dst[w] = (uint64_t)ma | ((uint64_t)mb << 32);
+    }
+#elif defined(CC_PACK_SSE2)
+    const __m128i vlo = _mm_set1_epi8((char)lo);
+    for (; x + 64 <= cols; x += 64, ++w) {
+        uint64_t bits = 0;
+        for (int k = 0; k < 4; ++k) {
+            __m128i v = _mm_loadu_si128((const __m128i*)(src + x + 16 * k));
+            uint32_t m = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_max_epu8(v, vlo), v));
+            bits |= (uint64_t)m << (16 * k);
+        }
+        dst[w] = bits;
+    }
+#endif
+    // 标量回退与行尾
+    for (; x < cols; x += 64, ++w) {
+        const int n = min(64, cols - x);
+        uint64_t bits = 0;
+        for (int i = 0; i < n; ++i) bits |= (uint64_t)(src[x + i] >= lo) << i;
+        dst[w] = bits;
+    }
+}
+
+}  // namespace
+
+void PackedBinaryMask::create(int rows, int cols) {
+    m_rows = rows;
+    m_cols = cols;
+    m_wordsPerRow = (cols + 63) / 64;
+    m_bits.assign((size_t)rows * m_wordsPerRow, 0);
+}
+
+void PackedBinaryMask::pack(const Mat& src, int lo, PackedBinaryMask& dst) {
+    dst.create(src.rows, src.cols);
+    if (lo > 255) return;  // 全部为背景
+    for (int y = 0; y < src.rows; ++y)
+        packRow(src.ptr<uchar>(y), src.cols, (uchar)lo, dst.row(y));
+}
+
+void PackedBinaryMask::fromGray(const Mat& gray, double thresh, PackedBinaryMask& dst) {
+    if (gray.empty() || gray.type() != CV_8UC1) {
+        cerr << "输入必须为单通道灰度图像" << endl;
+        dst.create(0, 0);
+        return;
+    }
+    // 8 位输入时 src > thresh 等价于 src >= floor(thresh) + 1
+    const double t = floor(thresh);
+    const int lo = t < 0 ? 0 : (t >= 255 ? 256 : (int)t + 1);
+    pack(gray, lo, dst);
+}
+
+void PackedBinaryMask::fromBinary(const Mat& binary, PackedBinaryMask& dst) {
+    if (binary.empty() || binary.type() != CV_8UC1) {
+        cerr << "输入必须为单通道二值图像" << endl;
+        dst.create(0, 0);
+        return;
+    }
+    pack(binary, 255, dst);
+}
+
+Mat PackedBinaryMask::toBinary() const {
+    Mat binary(m_rows, m_cols, CV_8UC1);
+    for (int y = 0; y < m_rows; ++y) {
+        uchar* dst = binary.ptr<uchar>(y);
+        for (int x = 0; x < m_cols; ++x) dst[x] = at(y, x) ? 255 : 0;
+    }
+    return binary;
+}
+
+size_t PackedBinaryMask::countNonZero() const {
+    size_t n = 0;
+    for (uint64_t w : m_bits) n += popcount64(w);
+    return n;
+}
+
+void PackedBinaryMask::appendRuns(int y, vector<Run>& runs) const {
+    const uint64_t* bits = row(y);
+    uint64_t carry = 0;  // 上一字的最高位
+    bool inRun = false;
+    int start = 0;
+
+    for (int w = 0; w < m_wordsPerRow; ++w) {
+        const uint64_t v = bits[w];
+        const uint64_t prev = (v << 1) | carry;
+        carry = v >> 63;
+        // 起点：本位为 1 且前一位为 0；终点：本位为 0 且前一位为 1。二者在位序上交替出现
+        uint64_t edges = (v & ~prev) | (~v & prev);
+        while (edges) {
+            const int x = (w << 6) + ctz64(edges);
+            if (inRun) runs.push_back({y, start, x, 0});
+            else start = x;
+            inRun = !inRun;
+            edges &= edges - 1;
+        }
+    }
+    // 宽度恰为 64 的整数倍时，行尾游程没有终点位
+    if (inRun) runs.push_back({y, start, m_cols, 0});
+}
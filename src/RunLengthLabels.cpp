@@ -0,0 +1,29 @@
+﻿#include "RunLengthLabels.h"
+#include "LabelingKernels.h"
+#include <algorithm>
+
+using namespace cv;
+
+Mat RunLengthLabels::toLabelMat(int depth) const {
+    Mat labels;
+    toLabelMat(labels, depth);
+    return labels;
+}
+
+void RunLengthLabels::toLabelMat(Mat& labels, int depth) const {
+    labels.create(rows, cols, depth == CV_16U ? CV_16U : CV_32S);
+    LabelingKernels::dispatchLabelType(labels.depth(), [&](auto tag) {
+        using LabelT = typename decltype(tag)::type;
+        for (int y = 0; y < rows; ++y) {
+            LabelT* dst = labels.ptr<LabelT>(y);
+            int x = 0;
+            for (int i = rowStart[y]; i < rowStart[y + 1]; ++i) {
+                const Run& r = runs[i];
+                std::fill(dst + x, dst + r.xStart, (LabelT)0);
+                std::fill(dst + r.xStart, dst + r.xEnd, (LabelT)r.label);
+                x = r.xEnd;
+            }
+            std::fill(dst + x, dst + cols, (LabelT)0);
+        }
+    });
+}
@@ -0,0 +1,31 @@
+﻿#pragma once
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+// 一行中的一段连续前景像素 [xStart, xEnd)
+struct Run {
+    int y;
+    int xStart, xEnd;
+    int label;  // 标记完成前为临时标签，完成后为最终标签（从 1 开始）
+};
+
+// 游程形式的连通域标记结果：游程按光栅顺序存放，
+// 第 y 行的游程位于 runs[rowStart[y], rowStart[y + 1])。
+struct RunLengthLabels {
+    int rows = 0, cols = 0;
+    int numComponents = 0;
+    std::vector<Run> runs;
+    std::vector<int> rowStart;
+
+    void reset(int rows_, int cols_) {
+        rows = rows_;
+        cols = cols_;
+        numComponents = 0;
+        runs.clear();
+        rowStart.assign(rows_ + 1, 0);
+    }
+
+    // 按需展开为标记矩阵，depth 为 CV_32S 或 CV_16U
+    cv::Mat toLabelMat(int depth = CV_32S) const;
+    void toLabelMat(cv::Mat& labels, int depth = CV_32S) const;
+};
@@ -0,0 +1,108 @@
+﻿#include "SparseLabeler.h"
+#include <algorithm>
+
+using namespace cv;
+using namespace std;
+
+static bool rasterLess(const Run& a, const Run& b) {
+    return a.y != b.y ? a.y < b.y : a.xStart < b.xStart;
+}
+
+int SparseLabeler::label(const vector<Point>& points) {
+    vector<Point> sorted(points);
+    sort(sorted.begin(), sorted.end(), [](const Point& a, const Point& b) { return a.y != b.y ? a.y < b.y : a.x < b.x; });
+
+    // 同一行中 x 连续的像素连成游程，重复坐标自然被吸收
+    m_runs.clear();
+    for (const Point& p : sorted) {
+        if (!m_runs.empty() && m_runs.back().y == p.y && m_runs.back().xEnd >= p.x)
+            m_runs.back().xEnd = max(m_runs.back().xEnd, p.x + 1);
+        else
+            m_runs.push_back({p.y, p.x, p.x + 1, 0});
+    }
+    return labelSorted();
+}
+
+int SparseLabeler::label(const vector<Run>& runs) {
+    m_runs = runs;
+    sort(m_runs.begin(), m_runs.end(), rasterLess);
+    return labelSorted();
+}
+
+int SparseLabeler::labelSorted() {
+    // 合并同一行内重叠或首尾相接的游程，丢弃空游程
+    size_t n = 0;
+    for (size_t i = 0; i < m_runs.size(); ++i) {
+        const Run r = m_runs[i];
+        if (r.xEnd <= r.xStart) continue;
+        if (n && m_runs[n - 1].y == r.y && m_runs[n - 1].xEnd >= r.xStart)
+            m_runs[n - 1].xEnd = max(m_runs[n - 1].xEnd, r.xEnd);
+        else
+            m_runs[n++] = r;
+    }
+    m_runs.resize(n);
+
+    // 逐行分组，每个游程只与紧邻上一行（y 相差 1）那一组中重叠的游程合并；
+    // 8 邻域下对角相接也算重叠：把上一行游程左右各扩一个像素
+    const int slack = m_useEightConnectivity ? 1 : 0;
+    m_equiv.reset(n);
+    size_t prevBegin = 0, prevEnd = 0;
+    for (size_t begin = 0; begin < n;) {
+        const int y = m_runs[begin].y;
+        size_t end = begin;
+        while (end < n && m_runs[end].y == y) ++end;
+        const bool adjacent = prevEnd > prevBegin && m_runs[prevBegin].y == y - 1;
+        size_t j = adjacent ? prevBegin : prevEnd;
+
+        for (size_t i = begin; i < end; ++i) {
+            Run& cur = m_runs[i];
+            int label = 0;
+            if (adjacent) {
+                while (j < prevEnd && m_runs[j].xEnd + slack <= cur.xStart) ++j;
+                for (size_t k = j; k < prevEnd && m_runs[k].xStart < cur.xEnd + slack; ++k)
+                    label = label ? m_equiv.merge(label, m_runs[k].label) : m_runs[k].label;
+            }
+            cur.label = label ? label : m_equiv.newLabel();
+        }
+        prevBegin = begin;
+        prevEnd = end;
+        begin = end;
+    }
+
+    // 统计量累加到根；临时标签按光栅顺序分配，根按升序编号即为首像素的光栅顺序
+    m_equiv.flatten();
+    const vector<int>& root = m_equiv.parent;
+    m_slots.assign(m_equiv.size(), ComponentRecord());
+    for (const Run& r : m_runs) m_slots[root[r.label]].addRun(r.y, r.xStart, r.xEnd);
+
+    m_components.clear();
+    m_finalLabel.assign(m_equiv.size(), 0);
+    for (int l = 1; l < m_equiv.size(); ++l) {
+        if (root[l] != l || m_slots[l].area < m_minSize) continue;
+        m_finalLabel[l] = (int)m_components.size() + 1;
+        m_components.push_back(m_slots[l]);
+        m_components.back().label = m_finalLabel[l];
+    }
+
+    // 改写为最终标签并移除被过滤的游程
+    n = 0;
+    for (size_t i = 0; i < m_runs.size(); ++i) {
+        Run r = m_runs[i];
+        r.label = m_finalLabel[root[r.label]];
+        if (r.label) m_runs[n++] = r;
+    }
+    m_runs.resize(n);
+    return numComponents();
+}
+
+Mat SparseLabeler::toLabelMat(const Rect& roi) const {
+    Mat labels = Mat::zeros(max(roi.height, 0), max(roi.width, 0), CV_32S);
+    if (labels.empty()) return labels;
+    auto it = lower_bound(m_runs.begin(), m_runs.end(), roi.y, [](const Run& r, int y) { return r.y < y; });
+    for (; it != m_runs.end() && it->y < roi.y + roi.height; ++it) {
+        const int x0 = max(it->xStart, roi.x), x1 = min(it->xEnd, roi.x + roi.width);
+        int* dst = labels.ptr<int>(it->y - roi.y);
+        for (int x = x0; x < x1; ++x) dst[x - roi.x] = it->label;
+    }
+    return labels;
+}
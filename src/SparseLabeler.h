@@ -0,0 +1,46 @@
+﻿#pragma once
+#include "ComponentStats.h"
+#include "LabelEquivalence.h"
+#include "RunLengthLabels.h"
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+// 稀疏前景的连通域标记：输入为前景像素坐标或稀疏游程，时间与内存都只与前景规模成正比，
+// 不分配、不扫描任何 rows * cols 或按行数计的结构，适合前景极少的超大图像。
+// 游程按 (y, x) 排序后按行分组，只在 y 相差 1 的两组之间按重叠关系合并；
+// 编号按首像素的光栅顺序，与 ConnectedComponentsUF 对同一图像的结果一致。
+// 结果为连通域统计列表与带最终标签的游程列表，需要时可只展开某个窗口的标记矩阵。
+class SparseLabeler {
+public:
+    // 选择4邻域或8邻域，默认4邻域
+    void setEightConnectivity(bool enabled) { m_useEightConnectivity = enabled; }
+    // 面积小于 minSize 的连通域被丢弃
+    void setMinSize(int minSize) { m_minSize = minSize; }
+
+    // 前景像素坐标，顺序任意，允许重复；返回连通域数
+    int label(const std::vector<cv::Point>& points);
+    // 稀疏游程掩码：只使用 y/xStart/xEnd，顺序任意，同一行内可重叠或首尾相接
+    int label(const std::vector<Run>& runs);
+
+    int numComponents() const { return (int)m_components.size(); }
+    // 第 i 项为标签 i + 1 的统计量
+    const std::vector<ComponentRecord>& components() const { return m_components; }
+    // 按光栅顺序排列、同一行内互不相接的游程，label 为最终标签；被过滤的游程已移除
+    const std::vector<Run>& runs() const { return m_runs; }
+
+    // 展开 roi 窗口内的标记矩阵（CV_32S），只访问与窗口相交的游程
+    cv::Mat toLabelMat(const cv::Rect& roi) const;
+
+private:
+    // 对已排序的 m_runs 合并相接游程，再标记
+    int labelSorted();
+
+    std::vector<Run> m_runs;
+    std::vector<ComponentRecord> m_components;
+    std::vector<ComponentRecord> m_slots;  // 以临时标签为下标
+    std::vector<int> m_finalLabel;
+    LabelEquivalence m_equiv;
+
+    int m_minSize = 0;
+    bool m_useEightConnectivity = false;
+};
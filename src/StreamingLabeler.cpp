@@ -0,0 +1,122 @@
+﻿#include "StreamingLabeler.h"
+#include <iostream>
+
+using namespace cv;
+using namespace std;
+
+void StreamingLabeler::begin(int cols, const ComponentSink& sink) {
+    m_cols = cols;
+    m_y = 0;
+    m_emitted = 0;
+    m_peakLive = 0;
+    m_sink = sink;
+    m_prevRuns.clear();
+    m_curRuns.clear();
+    m_live.assign(1, ComponentRecord());
+}
+
+void StreamingLabeler::emit(const ComponentRecord& rec) {
+    if (rec.area < m_minSize) return;
+    ComponentRecord out = rec;
+    out.label = ++m_emitted;
+    if (m_sink) m_sink(out);
+}
+
+void StreamingLabeler::pushRow(const uchar* row) {
+    const int slack = m_useEightConnectivity ? 1 : 0;
+    const int numLive = (int)m_live.size() - 1;
+
+    // 临时表：前 numLive 项为上一行留下的活跃连通域，其后为本行新开的连通域
+    m_equiv.reset(numLive + m_cols / 2 + 1);
+    m_slots.assign(m_live.begin(), m_live.end());
+    for (int i = 0; i < numLive; ++i) m_equiv.newLabel();
+
+    // 提取本行游程并与上一行重叠的游程合并
+    m_curRuns.clear();
+    size_t j = 0;
+    int x = 0;
+    while (x < m_cols) {
+        while (x < m_cols && row[x] != 255) ++x;
+        if (x == m_cols) break;
+        const int start = x;
+        while (x < m_cols && row[x] == 255) ++x;
+
+        while (j < m_prevRuns.size() && m_prevRuns[j].xEnd + slack <= start) ++j;
+        int label = 0;
+        for (size_t k = j; k < m_prevRuns.size() && m_prevRuns[k].xStart < x + slack; ++k)
+            label = label ? m_equiv.merge(label, m_prevRuns[k].label) : m_prevRuns[k].label;
+        if (!label) {
+            label = m_equiv.newLabel();
+            m_slots.emplace_back();
+        }
+        m_slots[label].addRun(m_y, start, x);
+        m_curRuns.push_back({m_y, start, x, label});
+    }
+
+    // 把各临时项的统计量并入根
+    m_equiv.flatten();
+    const vector<int>& root = m_equiv.parent;
+    for (int l = 1; l < m_equiv.size(); ++l) {
+        if (root[l] != l) m_slots[root[l]].merge(m_slots[l]);
+    }
+
+    // 本行有游程的根继续活跃，重新紧凑编号；其余根已不可能再生长，立即输出
+    m_newIndex.assign(m_equiv.size(), 0);
+    m_live.assign(1, ComponentRecord());
+    for (const Run& r : m_curRuns) {
+        const int rt = root[r.label];
+        if (!m_newIndex[rt]) {
+            m_newIndex[rt] = (int)m_live.size();
+            m_live.push_back(m_slots[rt]);
+        }
+    }
+    for (int l = 1; l <= numLive; ++l) {
+        if (root[l] == l && !m_newIndex[l]) emit(m_slots[l]);
+    }
+    for (Run& r : m_curRuns) r.label = m_newIndex[root[r.label]];
+
+    m_prevRuns.swap(m_curRuns);
+    m_peakLive = max(m_peakLive, (int)m_live.size() - 1);
+    ++m_y;
+}
+
+int StreamingLabeler::finish() {
+    for (size_t l = 1; l < m_live.size(); ++l) emit(m_live[l]);
+    m_live.assign(1, ComponentRecord());
+    m_prevRuns.clear();
+    return m_emitted;
+}
+
+int StreamingLabeler::run(int cols, const BandSource& source, const ComponentSink& sink) {
+    begin(cols, sink);
+    Mat band;
+    while (source(band)) {
+        if (band.empty()) continue;
+        if (band.type() != CV_8UC1 || band.cols != cols) {
+            // 图像不完整，活跃的连通域不能当作最终结果输出
+            cerr << "数据带必须为单通道二值图像且宽度一致" << endl;
+            return -1;
+        }
+        for (int y = 0; y < band.rows; ++y) pushRow(band.ptr<uchar>(y));
+    }
+    return finish();
+}
+
+int StreamingLabeler::run(const Mat& binary, const ComponentSink& sink, int bandRows) {
+    if (binary.empty() || binary.type() != CV_8UC1) {
+        cerr << "输入必须为单通道二值图像" << endl;
+        return -1;
+    }
+    if (bandRows < 1) {
+        cerr << "数据带行数必须大于 0" << endl;
+        return -1;
+    }
+    int y = 0;
+    return run(binary.cols, [&](Mat& band) {
+        if (y >= binary.rows) return false;
+        const int n = min(bandRows, binary.rows - y);
+        band = binary.rowRange(y, y + n);
+        y += n;
+        return true;
+    }, sink);
+}
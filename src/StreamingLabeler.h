@@ -0,0 +1,55 @@
+﻿#pragma once
+#include "ComponentStats.h"
+#include "LabelEquivalence.h"
+#include "RunLengthLabels.h"
+#include <opencv2/opencv.hpp>
+#include <functional>
+#include <vector>
+
+// 有界内存的流式连通域标记，用于放不进内存的超大图像。
+// 只保留上一行与当前行的游程，以及“仍可能继续生长”的连通域统计表；
+// 每处理完一行，凡是在当前行没有游程的连通域都不会再生长，立即输出其最终统计量。
+// 峰值内存为 O(宽度 + 活跃连通域数)，与图像总像素数无关。
+class StreamingLabeler {
+public:
+    // 数据源：每次把接下来的若干行（CV_8UC1，宽度固定，255 为前景）写入 band，返回 false 表示结束
+    using BandSource = std::function<bool(cv::Mat& band)>;
+    // 连通域完成时回调；label 按完成先后从 1 开始编号
+    using ComponentSink = std::function<void(const ComponentRecord&)>;
+
+    // 选择4邻域或8邻域，默认4邻域
+    void setEightConnectivity(bool enabled) { m_useEightConnectivity = enabled; }
+    // 面积小于 minSize 的连通域不输出
+    void setMinSize(int minSize) { m_minSize = minSize; }
+
+    // 从数据源读完整幅图像，返回输出的连通域数；数据带类型或宽度不符时返回 -1，不输出剩余的活跃连通域
+    int run(int cols, const BandSource& source, const ComponentSink& sink);
+    // 便利接口：把内存中的二值图按 bandRows 行一带送入；输入无效时返回 -1
+    int run(const cv::Mat& binary, const ComponentSink& sink, int bandRows = 64);
+
+    // 逐行接口：begin() 后逐行 pushRow()，最后 finish() 输出剩余连通域
+    void begin(int cols, const ComponentSink& sink);
+    void pushRow(const uchar* row);
+    int finish();
+
+    // 处理过程中同时活跃的连通域数峰值，用于确认内存上界
+    int peakLiveComponents() const { return m_peakLive; }
+
+private:
+    void emit(const ComponentRecord& rec);
+
+    int m_cols = 0;
+    int m_y = 0;
+    int m_emitted = 0;
+    int m_peakLive = 0;
+    ComponentSink m_sink;
+
+    std::vector<Run> m_prevRuns, m_curRuns;  // label 为活跃连通域下标（从 1 开始）
+    std::vector<ComponentRecord> m_live;     // 上一行结束时仍活跃的连通域，下标 0 不用
+    std::vector<ComponentRecord> m_slots;    // 当前行处理中的临时表
+    std::vector<int> m_newIndex;
+    LabelEquivalence m_equiv;
+
+    int m_minSize = 0;
+    bool m_useEightConnectivity = false;
+};
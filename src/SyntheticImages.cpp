@@ -0,0 +1,95 @@
+﻿#include "SyntheticImages.h"
+#include <algorithm>
+#include <random>
+
+using namespace cv;
+using namespace std;
+
+Mat SyntheticImages::noise(int rows, int cols, double density, unsigned seed) {
+    Mat m(rows, cols, CV_8UC1);
+    mt19937 rng(seed);
+    // 以整数阈值比较，避免依赖浮点分布在不同标准库上的实现差异
+    const uint32_t threshold = (uint32_t)(min(max(density, 0.0), 1.0) * 4294967295.0);
+    for (int y = 0; y < rows; ++y) {
+        uchar* row = m.ptr<uchar>(y);
+        for (int x = 0; x < cols; ++x) row[x] = (uint32_t)rng() < threshold ? 255 : 0;
+    }
+    return m;
+}
+
+Mat SyntheticImages::checkerboard(int rows, int cols, int cell) {
+    cell = max(cell, 1);
+    Mat m(rows, cols, CV_8UC1);
+    for (int y = 0; y < rows; ++y) {
+        uchar* row = m.ptr<uchar>(y);
+        for (int x = 0; x < cols; ++x) row[x] = ((x / cell + y / cell) & 1) ? 255 : 0;
+    }
+    return m;
+}
+
+Mat SyntheticImages::spiral(int rows, int cols, int width) {
+    width = max(width, 1);
+    Mat m = Mat::zeros(rows, cols, CV_8UC1);
+    if (rows < width || cols < width) return m;
+    // 宽 width 的画笔沿 右、下、左、上 依次前进，每走完一段把对应边界向内收 2*width，
+    // 相邻两圈之间留下 width 宽的间隙
+    const int step = 2 * width;
+    int minX = 0, maxX = cols - width, minY = 0, maxY = rows - width;
+    int x = 0, y = 0;
+    auto stroke = [&](int nx, int ny) {
+        m(Range(min(y, ny), max(y, ny) + width), Range(min(x, nx), max(x, nx) + width)).setTo(255);
+        x = nx;
+        y = ny;
+    };
+    for (int dir = 0;; dir = (dir + 1) % 4) {
+        if (minX > maxX || minY > maxY) break;
+        switch (dir) {
+        case 0: stroke(maxX, y); minY += step; break;
+        case 1: stroke(x, maxY); maxX -= step; break;
+        case 2: stroke(minX, y); maxY -= step; break;
+        default: stroke(x, minY); minX += step; break;
+        }
+    }
+    return m;
+}
+
+Mat SyntheticImages::blobs(int rows, int cols, int count, int maxRadius, unsigned seed) {
+    Mat m = Mat::zeros(rows, cols, CV_8UC1);
+    mt19937 rng(seed);
+    maxRadius = max(maxRadius, 1);
+    for (int i = 0; i < count; ++i) {
+        const int cx = (int)(rng() % (uint32_t)cols), cy = (int)(rng() % (uint32_t)rows);
+        const int r = 1 + (int)(rng() % (uint32_t)maxRadius);
+        for (int y = max(cy - r, 0); y <= min(cy + r, rows - 1); ++y) {
+            uchar* row = m.ptr<uchar>(y);
+            for (int x = max(cx - r, 0); x <= min(cx + r, cols - 1); ++x)
+                if ((x - cx) * (x - cx) + (y - cy) * (y - cy) <= r * r) row[x] = 255;
+        }
+    }
+    return m;
+}
+
+Mat SyntheticImages::mergeChain(int rows, int cols) {
+    Mat m = Mat::zeros(rows, cols, CV_8UC1);
+    for (int y = 0; y < rows; ++y) {
+        uchar* row = m.ptr<uchar>(y);
+        if (y == rows - 1) {
+            fill(row, row + cols, (uchar)255);
+        } else {
+            for (int x = 0; x < cols; x += 2) row[x] = 255;
+        }
+    }
+    return m;
+}
+
+vector<SyntheticImages::Case> SyntheticImages::standardSuite(int rows, int cols, unsigned seed) {
+    const string size = "_" + to_string(cols) + "x" + to_string(rows);
+    vector<Case> cases;
+    for (int d : {10, 50, 90}) cases.push_back({"noise" + to_string(d) + size, noise(rows, cols, d / 100.0, seed + d)});
+    cases.push_back({"checker1" + size, checkerboard(rows, cols, 1)});
+    cases.push_back({"checker8" + size, checkerboard(rows, cols, 8)});
+    cases.push_back({"spiral" + size, spiral(rows, cols, 2)});
+    cases.push_back({"blobs" + size, blobs(rows, cols, max(rows * cols / 2048, 1), 12, seed)});
+    cases.push_back({"mergechain" + size, mergeChain(rows, cols)});
+    return cases;
+}
@@ -0,0 +1,29 @@
+﻿#pragma once
+#include <opencv2/opencv.hpp>
+#include <string>
+#include <vector>
+
+// 确定性的合成二值图像（CV_8UC1，255 为前景），用于基准测试。
+// 同样的参数与种子总是生成完全相同的图像，便于不同构建之间对比。
+class SyntheticImages {
+public:
+    struct Case {
+        std::string name;  // 形如 "noise50_1024x1024"
+        cv::Mat binary;
+    };
+
+    // 独立同分布随机噪声，density 为前景比例
+    static cv::Mat noise(int rows, int cols, double density, unsigned seed);
+    // 棋盘格：cell 为格子边长；cell = 1 时 4 邻域下每个前景像素都是独立连通域
+    static cv::Mat checkerboard(int rows, int cols, int cell);
+    // 方形螺旋：宽 width 的单条通道从外圈绕向中心，整幅图只有一个细长连通域
+    static cv::Mat spiral(int rows, int cols, int width);
+    // 颗粒状斑块：count 个半径不超过 maxRadius 的随机圆盘
+    static cv::Mat blobs(int rows, int cols, int count, int maxRadius, unsigned seed);
+    // 最坏情况合并链：竖直齿条在最后一行才连成一体（梳子形），
+    // 扫描类算法先分配大量临时标签，到底部才逐一合并
+    static cv::Mat mergeChain(int rows, int cols);
+
+    // 标准用例集：每种分布在 rows x cols 下各一幅
+    static std::vector<Case> standardSuite(int rows, int cols, unsigned seed = 1);
+};
@@ -0,0 +1,82 @@
+﻿#include "ThreadPool.h"
+#include <atomic>
+
+using namespace std;
+
+ThreadPool::ThreadPool(int numThreads) {
+    if (numThreads <= 0) numThreads = max(1u, thread::hardware_concurrency());
+    m_workers.reserve(numThreads);
+    for (int i = 0; i < numThreads; ++i)
+        m_workers.emplace_back([this] { workerLoop(); });
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        lock_guard<mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_cv.notify_all();
+    for (auto& t : m_workers) t.join();
+}
+
+void ThreadPool::submit(function<void()> task) {
+    {
+        lock_guard<mutex> lock(m_mutex);
+        m_tasks.push_back(std::move(task));
+    }
+    m_cv.notify_one();
+}
+
+void ThreadPool::workerLoop() {
+    for (;;) {
+        function<void()> task;
+        {
+            unique_lock<mutex> lock(m_mutex);
+            m_cv.wait(lock, [this] { return m_stop || !m_tasks.empty(); });
+            if (m_stop && m_tasks.empty()) return;
+            task = std::move(m_tasks.front());
+            m_tasks.pop_front();
+        }
+        task();
+    }
+}
+
+void ThreadPool::parallelFor(int n, const function<void(int)>& body) {
+    if (n <= 0) return;
+    if (n == 1) {
+        body(0);
+        return;
+    }
+
+    // 各线程从共享计数器领取下标，调用线程也参与；helpers 计数归零后返回。
+    // 返回前必然等到所有 helper 结束，状态放在栈上即可
+    struct State {
+        atomic<int> next{0};
+        int pending = 0;
+        int n = 0;
+        const function<void(int)>* body = nullptr;
+        mutex m;
+        condition_variable done;
+
+        void drain() {
+            for (int i = next++; i < n; i = next++) (*body)(i);
+        }
+    } state;
+    state.n = n;
+    state.body = &body;
+
+    const int helpers = min(size(), n - 1);
+    state.pending = helpers;
+    State* s = &state;
+    for (int h = 0; h < helpers; ++h) {
+        submit([s] {
+            s->drain();
+            lock_guard<mutex> lock(s->m);
+            if (--s->pending == 0) s->done.notify_one();
+        });
+    }
+    state.drain();
+
+    unique_lock<mutex> lock(state.m);
+    state.done.wait(lock, [&] { return state.pending == 0; });
+}
@@ -0,0 +1,34 @@
+﻿#pragma once
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// 固定大小的线程池
+class ThreadPool {
+public:
+    // numThreads <= 0 时使用硬件线程数
+    explicit ThreadPool(int numThreads = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    int size() const { return (int)m_workers.size(); }
+
+    void submit(std::function<void()> task);
+
+    // 对 [0, n) 中每个下标执行 body，调用线程也参与执行，全部完成后返回
+    void parallelFor(int n, const std::function<void(int)>& body);
+
+private:
+    void workerLoop();
+
+    std::vector<std::thread> m_workers;
+    std::deque<std::function<void()>> m_tasks;
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    bool m_stop = false;
+};
@@ -0,0 +1,72 @@
+﻿#include "ThresholdClose.h"
+#include <algorithm>
+
+using namespace cv;
+using namespace std;
+
+// 水平方向 3 邻域极值（越界不参与）：Max 为膨胀，否则为腐蚀
+template <bool Max>
+static void horizontal3(const uchar* src, uchar* dst, int cols) {
+    auto pick = [](uchar a, uchar b) { return Max ? max(a, b) : min(a, b); };
+    if (cols == 1) {
+        dst[0] = src[0];
+        return;
+    }
+    dst[0] = pick(src[0], src[1]);
+    for (int x = 1; x + 1 < cols; ++x) dst[x] = pick(pick(src[x - 1], src[x]), src[x + 1]);
+    dst[cols - 1] = pick(src[cols - 2], src[cols - 1]);
+}
+
+// 相邻行逐元素极值；a、c 可为空（越界行）
+template <bool Max>
+static void vertical3(const uchar* a, const uchar* b, const uchar* c, uchar* dst, int cols) {
+    auto pick = [](uchar u, uchar v) { return Max ? max(u, v) : min(u, v); };
+    copy(b, b + cols, dst);
+    if (a)
+        for (int x = 0; x < cols; ++x) dst[x] = pick(dst[x], a[x]);
+    if (c)
+        for (int x = 0; x < cols; ++x) dst[x] = pick(dst[x], c[x]);
+}
+
+void ThresholdClose::run(const Mat& gray, double thresh, const RowSink& sink) {
+    CV_Assert(gray.type() == CV_8UC1);
+    const int rows = gray.rows, cols = gray.cols;
+    if (rows == 0 || cols == 0) return;
+
+    // 8 位图像的 THRESH_BINARY：阈值先向下取整，src > t 置 255
+    uchar lut[256];
+    const int t = cvFloor(thresh);
+    for (int v = 0; v < 256; ++v) lut[v] = v > t ? 255 : 0;
+
+    // 缓冲布局：H[3] | E[3] | T | D，各 cols 字节
+    m_buffer.resize((size_t)8 * cols);
+    uchar* hRing[3] = {&m_buffer[0], &m_buffer[(size_t)cols], &m_buffer[(size_t)2 * cols]};
+    uchar* eRing[3] = {&m_buffer[(size_t)3 * cols], &m_buffer[(size_t)4 * cols], &m_buffer[(size_t)5 * cols]};
+    uchar* tRow = &m_buffer[(size_t)6 * cols];
+    uchar* work = &m_buffer[(size_t)7 * cols];
+
+    // 第 k 步：阈值化并水平膨胀第 k 行 -> 垂直膨胀得到第 k-1 行膨胀结果并水平腐蚀 -> 垂直腐蚀输出第 k-2 行
+    for (int k = 0; k < rows + 2; ++k) {
+        if (k < rows) {
+            const uchar* src = gray.ptr<uchar>(k);
+            for (int x = 0; x < cols; ++x) tRow[x] = lut[src[x]];
+            horizontal3<true>(tRow, hRing[k % 3], cols);
+        }
+        const int d = k - 1;
+        if (d >= 0 && d < rows) {
+            vertical3<true>(d > 0 ? hRing[(d - 1) % 3] : nullptr, hRing[d % 3], d + 1 < rows ? hRing[(d + 1) % 3] : nullptr, work, cols);
+            horizontal3<false>(work, eRing[d % 3], cols);
+        }
+        const int c = k - 2;
+        if (c >= 0) {
+            vertical3<false>(c > 0 ? eRing[(c - 1) % 3] : nullptr, eRing[c % 3], c + 1 < rows ? eRing[(c + 1) % 3] : nullptr, work, cols);
+            sink(c, work);
+        }
+    }
+}
+
+Mat ThresholdClose::apply(const Mat& gray, double thresh) {
+    Mat binary(gray.rows, gray.cols, CV_8UC1);
+    run(gray, thresh, [&](int y, const uchar* row) { copy(row, row + gray.cols, binary.ptr<uchar>(y)); });
+    return binary;
+}
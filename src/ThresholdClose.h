@@ -0,0 +1,26 @@
+﻿#pragma once
+#include <opencv2/opencv.hpp>
+#include <functional>
+#include <vector>
+
+// 融合预处理前端：逐行计算 threshold(THRESH_BINARY, 255) 与 3x3 矩形闭运算（先膨胀后腐蚀），
+// 结果与 cv::threshold + cv::morphologyEx(MORPH_CLOSE) 逐位一致——OpenCV 形态学的默认边界
+// 使越界像素不参与 max/min，这里同样只在图像内取邻域。
+// 矩形核可分离：先水平 3 邻域取极值，再在相邻 3 行间取极值；
+// 只保留 3 行水平膨胀、3 行水平腐蚀与 2 行临时缓冲，不生成整幅中间图像。
+class ThresholdClose {
+public:
+    // 每算出一行闭运算结果就回调一次，row 指向内部缓冲，仅在回调期间有效
+    using RowSink = std::function<void(int y, const uchar* row)>;
+
+    // gray 必须为 CV_8UC1 的整幅图像（不是 ROI）
+    void run(const cv::Mat& gray, double thresh, const RowSink& sink);
+
+    // 便利接口：输出完整的二值图，用于与原预处理流程对照
+    cv::Mat apply(const cv::Mat& gray, double thresh);
+
+    const std::vector<uchar>& buffer() const { return m_buffer; }
+
+private:
+    std::vector<uchar> m_buffer;
+};
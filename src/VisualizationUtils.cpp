@@ -1,68 +1,105 @@
 ﻿#include "VisualizationUtils.h"
+#include "LabelingKernels.h"
+#include <algorithm>
+#include <array>
+
+// 色相 -> BGR 颜色表（饱和度、亮度均为 255），首次使用时一次性转换 180 个色相
+static const std::array<cv::Vec3b, 180>& hueTable() {
+    static const std::array<cv::Vec3b, 180> table = [] {
+        cv::Mat hsv(1, 180, CV_8UC3);
+        for (int h = 0; h < 180; ++h) hsv.at<cv::Vec3b>(0, h) = cv::Vec3b((uchar)h, 255, 255);
+        cv::Mat bgr;
+        cv::cvtColor(hsv, bgr, cv::COLOR_HSV2BGR);
+        std::array<cv::Vec3b, 180> t;
+        for (int h = 0; h < 180; ++h) t[h] = bgr.at<cv::Vec3b>(0, h);
+        return t;
+    }();
+    return table;
+}
+
+// 方案 0、1 的色相是标签的周期函数（周期整除 180），各缓存一张 180 项的调色板
+static const std::array<cv::Vec3b, 180>& periodicPalette(int colorScheme) {
+    static const auto build = [](int scheme) {
+        std::array<cv::Vec3b, 180> p;
+        for (int i = 0; i < 180; ++i) p[i] = hueTable()[scheme == 1 ? ((i * 37) + 90) % 180 : (i * 45) % 180];
+        return p;
+    };
+    static const std::array<cv::Vec3b, 180> scheme0 = build(0), scheme1 = build(1);
+    return colorScheme == 1 ? scheme1 : scheme0;
+}
 
 cv::Vec3b VisualizationUtils::generateColor(int index, int colorScheme) {
-    float hue;
-    
-    switch (colorScheme) {
-        case 1: // 替代配色方案
-            hue = ((index * 37) + 90) % 180;
-            break;
-        case 2: // 随机配色
-            std::srand(index * 12345);
-            hue = std::rand() % 180;
-            break;
-        case 0: // 默认配色方案
-        default:
-            hue = (index * 45) % 180;
-            break;
+    if (colorScheme == 2) {
+        // 随机配色
+        std::srand(index * 12345);
+        return hueTable()[std::rand() % 180];
     }
-    
-    cv::Mat hsv(1, 1, CV_8UC3, cv::Scalar(hue, 255, 255));
-    cv::Mat bgr;
-    cv::cvtColor(hsv, bgr, cv::COLOR_HSV2BGR);
-    return bgr.at<cv::Vec3b>(0, 0);
+    return periodicPalette(colorScheme)[((index % 180) + 180) % 180];
 }
 
-cv::Mat VisualizationUtils::labelsToColorImage(const cv::Mat& labels, int numComponents, int colorScheme) {
-    int rows = labels.rows;
-    int cols = labels.cols;
-    cv::Mat colorImg(rows, cols, CV_8UC3, cv::Scalar(0, 0, 0));
-    
-    for (int i = 1; i <= numComponents; ++i) {
-        cv::Vec3b color = generateColor(i, colorScheme);
-        
-        for (int y = 0; y < rows; ++y) {
-            for (int x = 0; x < cols; ++x) {
-                if (labels.at<int>(y, x) == i) {
-                    colorImg.at<cv::Vec3b>(y, x) = color;
+std::vector<cv::Vec3b> VisualizationUtils::buildPalette(int numComponents, int colorScheme) {
+    std::vector<cv::Vec3b> lut((size_t)std::max(numComponents, 0) + 1, cv::Vec3b(0, 0, 0));
+    for (int i = 1; i <= numComponents; ++i) lut[i] = generateColor(i, colorScheme);
+    return lut;
+}
+
+// 单遍并行着色：查表得到颜色；alpha > 0 时与灰度图做定点混合（alpha 量化为 /256）。
+// 标签 0 与超出 [1, numComponents] 的标签视为黑色，与原先逐连通域扫描的结果一致
+template <typename LabelT, bool Blend>
+static void colorizeRows(const cv::Mat& labels, const cv::Mat& gray, const std::vector<cv::Vec3b>& lut, int a,
+                         cv::Mat& dst, const cv::Range& range) {
+    const unsigned n = (unsigned)lut.size() - 1;
+    const int ia = 256 - a;
+    for (int y = range.start; y < range.end; ++y) {
+        const LabelT* lbl = labels.ptr<LabelT>(y);
+        const uchar* g = Blend ? gray.ptr<uchar>(y) : nullptr;
+        cv::Vec3b* out = dst.ptr<cv::Vec3b>(y);
+        for (int x = 0; x < labels.cols; ++x) {
+            const unsigned l = (unsigned)lbl[x];
+            const cv::Vec3b c = l <= n ? lut[l] : lut[0];
+            if constexpr (Blend) {
+                if (l == 0) {
+                    out[x] = cv::Vec3b(g[x], g[x], g[x]);
+                } else {
+                    const int base = g[x] * ia + 128;
+                    out[x] = cv::Vec3b((uchar)((c[0] * a + base) >> 8), (uchar)((c[1] * a + base) >> 8),
+                                       (uchar)((c[2] * a + base) >> 8));
                 }
+            } else {
+                out[x] = c;
             }
         }
     }
-    
+}
+
+template <bool Blend>
+static void colorize(const cv::Mat& labels, const cv::Mat& gray, const std::vector<cv::Vec3b>& lut, int a, cv::Mat& dst) {
+    LabelingKernels::dispatchLabelType(labels.depth(), [&](auto tag) {
+        using LabelT = typename decltype(tag)::type;
+        cv::parallel_for_(cv::Range(0, labels.rows), [&](const cv::Range& range) {
+            colorizeRows<LabelT, Blend>(labels, gray, lut, a, dst, range);
+        });
+    });
+}
+
+cv::Mat VisualizationUtils::labelsToColorImage(const cv::Mat& labels, int numComponents, int colorScheme) {
+    // 检测器对非法输入返回空矩阵，此时同样返回空图像，由调用方报告错误
+    if (labels.empty()) return cv::Mat();
+    CV_Assert(labels.type() == CV_32S || labels.type() == CV_16U);
+    cv::Mat colorImg(labels.rows, labels.cols, CV_8UC3);
+    colorize<false>(labels, cv::Mat(), buildPalette(numComponents, colorScheme), 0, colorImg);
     return colorImg;
 }
 
 cv::Mat VisualizationUtils::createOverlay(const cv::Mat& gray, const cv::Mat& labels, 
                                           int numComponents, double alpha, int colorScheme) {
-    cv::Mat overlay;
-    cv::cvtColor(gray, overlay, cv::COLOR_GRAY2BGR);
-    
-    // 先生成彩色图像
-    cv::Mat colorImg = labelsToColorImage(labels, numComponents, colorScheme);
-    
-    // alpha混合
-    for (int y = 0; y < overlay.rows; ++y) {
-        for (int x = 0; x < overlay.cols; ++x) {
-            if (labels.at<int>(y, x) > 0) {
-                cv::Vec3b& pixel = overlay.at<cv::Vec3b>(y, x);
-                cv::Vec3b color = colorImg.at<cv::Vec3b>(y, x);
-                pixel[0] = cv::saturate_cast<uchar>(alpha * color[0] + (1 - alpha) * pixel[0]);
-                pixel[1] = cv::saturate_cast<uchar>(alpha * color[1] + (1 - alpha) * pixel[1]);
-                pixel[2] = cv::saturate_cast<uchar>(alpha * color[2] + (1 - alpha) * pixel[2]);
-            }
-        }
-    }
-    
+    CV_Assert(gray.type() == CV_8UC1 && gray.size() == labels.size());
+    CV_Assert(labels.type() == CV_32S || labels.type() == CV_16U);
+    cv::Mat overlay(gray.rows, gray.cols, CV_8UC3);
+
+    // 灰度转三通道、查表着色与 alpha 混合合并为一遍
+    const int a = cvRound(std::min(std::max(alpha, 0.0), 1.0) * 256);
+    colorize<true>(labels, gray, buildPalette(numComponents, colorScheme), a, overlay);
+
     return overlay;
 }
@@ -0,0 +1,264 @@
+﻿#include "VolumeLabeler.h"
+#include "LabelEquivalence.h"
+#include <iostream>
+#include <utility>
+
+using namespace cv;
+using namespace std;
+
+// 各邻域下游程相连的判定：slack 为 1 时 x 方向对角相接也算相连，为 -1 表示该方向不相连
+struct Slack {
+    int inSlice;        // 同一切片相邻两行
+    int crossSame;      // 相邻切片的同一行
+    int crossAdjacent;  // 相邻切片的相邻行
+};
+
+static Slack slackOf(int connectivity) {
+    switch (connectivity) {
+    case 26: return {1, 1, 1};
+    case 18: return {1, 1, 0};
+    default: return {0, 0, -1};
+    }
+}
+
+// 枚举两行游程中相连的游程对（两行的游程都按 x 升序）
+template <typename F>
+static void forEachTouching(const Run* a, const Run* aEnd, const Run* b, const Run* bEnd, int slack, F&& f) {
+    const Run* j = b;
+    for (; a != aEnd; ++a) {
+        while (j != bEnd && j->xEnd + slack <= a->xStart) ++j;
+        for (const Run* k = j; k != bEnd && k->xStart < a->xEnd + slack; ++k) f(*a, *k);
+    }
+}
+
+static const Run* rowBegin(const RunLengthLabels& rl, int y) { return rl.runs.data() + rl.rowStart[y]; }
+static const Run* rowEnd(const RunLengthLabels& rl, int y) { return rl.runs.data() + rl.rowStart[y + 1]; }
+
+// 枚举相邻两张切片之间相连的游程对，f(当前切片游程, 上一切片游程)
+template <typename F>
+static void forEachTouchingSlices(const RunLengthLabels& prev, const RunLengthLabels& cur, const Slack& slack, F&& f) {
+    for (int y = 0; y < cur.rows; ++y) {
+        forEachTouching(rowBegin(cur, y), rowEnd(cur, y), rowBegin(prev, y), rowEnd(prev, y), slack.crossSame, f);
+        if (slack.crossAdjacent < 0) continue;
+        if (y > 0)
+            forEachTouching(rowBegin(cur, y), rowEnd(cur, y), rowBegin(prev, y - 1), rowEnd(prev, y - 1), slack.crossAdjacent, f);
+        if (y + 1 < cur.rows)
+            forEachTouching(rowBegin(cur, y), rowEnd(cur, y), rowBegin(prev, y + 1), rowEnd(prev, y + 1), slack.crossAdjacent, f);
+    }
+}
+
+static void extractRuns(const Mat& slice, RunLengthLabels& rl) {
+    rl.reset(slice.rows, slice.cols);
+    for (int y = 0; y < slice.rows; ++y) {
+        const uchar* src = slice.ptr<uchar>(y);
+        int x = 0;
+        while (x < slice.cols) {
+            while (x < slice.cols && src[x] != 255) ++x;
+            if (x == slice.cols) break;
+            const int start = x;
+            while (x < slice.cols && src[x] == 255) ++x;
+            rl.runs.push_back({y, start, x, 0});
+        }
+        rl.rowStart[y + 1] = (int)rl.runs.size();
+    }
+}
+
+static int findFace(vector<int>& parent, int f) {
+    while (parent[f] != f) {
+        parent[f] = parent[parent[f]];
+        f = parent[f];
+    }
+    return f;
+}
+
+void VolumeLabeler::setConnectivity(int connectivity) {
+    m_connectivity = connectivity == 18 || connectivity == 26 ? connectivity : 6;
+}
+
+void VolumeLabeler::setNumThreads(int numThreads) {
+    m_pool.reset(new ThreadPool(numThreads));
+}
+
+void VolumeLabeler::labelSlab(int rows, int cols, int depth, const SliceReader& reader, Slab& slab) const {
+    const Slack slack = slackOf(m_connectivity);
+    const bool pinTop = slab.z0 > 0, pinBottom = slab.z1 < depth;
+
+    RunLengthLabels prev, cur;
+    prev.reset(rows, cols);
+    vector<Live> live(1), slots;
+    vector<int> newIndex;
+    LabelEquivalence eq;
+    vector<int> faceParent;                  // 顶面连通域之间的并查集：它们可能在厚片内部才连到一起
+    vector<pair<int, VolumeRecord>> pinned;  // 已经结束但触及顶面的连通域
+    Mat slice;
+
+    auto finish = [&](const Live& l) {
+        if (l.face >= 0) pinned.emplace_back(l.face, l.rec);
+        else slab.done.push_back(l.rec);
+    };
+
+    for (int z = slab.z0; z < slab.z1; ++z) {
+        if (!reader(z, slice) || slice.type() != CV_8UC1 || slice.rows != rows || slice.cols != cols) {
+            slab.ok = false;
+            return;
+        }
+        extractRuns(slice, cur);
+
+        // 临时表：前 numLive 项为上一切片留下的活跃连通域，其后每个游程各占一项
+        const int numLive = (int)live.size() - 1;
+        eq.reset(numLive + cur.runs.size());
+        for (int i = 0; i < numLive; ++i) eq.newLabel();
+        for (Run& r : cur.runs) r.label = eq.newLabel();
+        auto unite = [&](const Run& a, const Run& b) { eq.merge(a.label, b.label); };
+        for (int y = 1; y < rows; ++y)
+            forEachTouching(rowBegin(cur, y), rowEnd(cur, y), rowBegin(cur, y - 1), rowEnd(cur, y - 1), slack.inSlice, unite);
+        forEachTouchingSlices(prev, cur, slack, unite);
+        eq.flatten();
+        const vector<int>& root = eq.parent;
+
+        // 统计量并入根；两个触及顶面的连通域相遇时合并它们的顶面项
+        slots.assign(eq.size(), Live());
+        for (int l = 1; l <= numLive; ++l) slots[l] = live[l];
+        for (const Run& r : cur.runs) slots[r.label].rec.addRun(z, r.y, r.xStart, r.xEnd, rows, cols);
+        for (int l = 1; l < eq.size(); ++l) {
+            if (root[l] == l) continue;
+            Live& dst = slots[root[l]];
+            const Live& src = slots[l];
+            dst.rec.merge(src.rec);
+            if (src.face < 0) continue;
+            if (dst.face < 0) {
+                dst.face = src.face;
+            } else {
+                const int a = findFace(faceParent, dst.face), b = findFace(faceParent, src.face);
+                faceParent[max(a, b)] = min(a, b);
+                dst.face = min(a, b);
+            }
+        }
+
+        // 在本切片有游程的根继续活跃并紧凑编号，其余已不可能再生长
+        newIndex.assign(eq.size(), 0);
+        live.assign(1, Live());
+        for (const Run& r : cur.runs) {
+            const int rt = root[r.label];
+            if (!newIndex[rt]) {
+                newIndex[rt] = (int)live.size();
+                live.push_back(slots[rt]);
+            }
+        }
+        for (int l = 1; l <= numLive; ++l)
+            if (root[l] == l && !newIndex[l]) finish(slots[l]);
+        for (Run& r : cur.runs) r.label = newIndex[root[r.label]];
+
+        // 厚片第一张切片上的连通域都触及顶面，各自登记一个顶面项（编号 = 活跃下标 - 1）
+        if (z == slab.z0 && pinTop) {
+            for (size_t i = 1; i < live.size(); ++i) {
+                live[i].face = (int)faceParent.size();
+                faceParent.push_back(live[i].face);
+            }
+            slab.topFace = cur;
+            for (Run& r : slab.topFace.runs) r.label -= 1;
+        }
+
+        swap(prev, cur);
+        slab.peakLive = max(slab.peakLive, (int)live.size() - 1);
+    }
+
+    if (!pinBottom) {
+        for (size_t i = 1; i < live.size(); ++i) finish(live[i]);
+        live.assign(1, Live());
+    }
+
+    // 汇总需要跨厚片合并的连通域：同一顶面根只占一项，底面上未触及顶面的各占一项
+    vector<int> faceBoundary(faceParent.size(), -1);
+    auto boundaryOfFace = [&](int face) {
+        const int rt = findFace(faceParent, face);
+        if (faceBoundary[rt] < 0) {
+            faceBoundary[rt] = (int)slab.boundary.size();
+            slab.boundary.emplace_back();
+        }
+        return faceBoundary[rt];
+    };
+    for (const auto& p : pinned) slab.boundary[boundaryOfFace(p.first)].merge(p.second);
+    for (Run& r : slab.topFace.runs) r.label = boundaryOfFace(r.label);
+
+    vector<int> liveBoundary(live.size(), -1);
+    for (size_t i = 1; i < live.size(); ++i) {
+        int b;
+        if (live[i].face >= 0) {
+            b = boundaryOfFace(live[i].face);
+        } else {
+            b = (int)slab.boundary.size();
+            slab.boundary.emplace_back();
+        }
+        slab.boundary[b].merge(live[i].rec);
+        liveBoundary[i] = b;
+    }
+    if (pinBottom) {
+        slab.bottomFace = prev;
+        for (Run& r : slab.bottomFace.runs) r.label = liveBoundary[r.label];
+    }
+}
+
+vector<VolumeRecord> VolumeLabeler::label(int rows, int cols, int depth, const SliceReader& reader) {
+    m_peakLive = 0;
+    if (rows <= 0 || cols <= 0 || depth <= 0) return {};
+    if (!m_pool) setNumThreads(0);
+
+    // 沿 z 轴划分厚片并行标记
+    const int numSlabs = min(depth, m_pool->size());
+    vector<Slab> slabs(numSlabs);
+    for (int s = 0; s < numSlabs; ++s) {
+        slabs[s].z0 = (int)((int64_t)depth * s / numSlabs);
+        slabs[s].z1 = (int)((int64_t)depth * (s + 1) / numSlabs);
+    }
+    m_pool->parallelFor(numSlabs, [&](int s) { labelSlab(rows, cols, depth, reader, slabs[s]); });
+    for (const Slab& slab : slabs) {
+        if (!slab.ok) {
+            cerr << "切片读取失败，或切片不是尺寸一致的单通道二值图像" << endl;
+            return {};
+        }
+        m_peakLive = max(m_peakLive, slab.peakLive);
+    }
+
+    // 在相邻厚片的接触面上合并边界连通域（全局编号 = 厚片偏移 + 边界下标 + 1）
+    vector<int> offset(numSlabs + 1, 0);
+    for (int s = 0; s < numSlabs; ++s) offset[s + 1] = offset[s] + (int)slabs[s].boundary.size();
+    LabelEquivalence eq;
+    eq.reset(offset[numSlabs]);
+    for (int i = 0; i < offset[numSlabs]; ++i) eq.newLabel();
+    const Slack slack = slackOf(m_connectivity);
+    for (int s = 0; s + 1 < numSlabs; ++s) {
+        forEachTouchingSlices(slabs[s].bottomFace, slabs[s + 1].topFace, slack, [&](const Run& next, const Run& last) {
+            eq.merge(offset[s + 1] + next.label + 1, offset[s] + last.label + 1);
+        });
+    }
+    eq.flatten();
+
+    vector<VolumeRecord> merged(offset[numSlabs] + 1);
+    for (int s = 0; s < numSlabs; ++s)
+        for (size_t b = 0; b < slabs[s].boundary.size(); ++b)
+            merged[eq.parent[offset[s] + (int)b + 1]].merge(slabs[s].boundary[b]);
+
+    vector<VolumeRecord> out;
+    for (const Slab& slab : slabs)
+        for (const VolumeRecord& rec : slab.done)
+            if (rec.volume >= m_minSize) out.push_back(rec);
+    for (int l = 1; l < eq.size(); ++l)
+        if (eq.parent[l] == l && merged[l].volume >= m_minSize) out.push_back(merged[l]);
+
+    // 按首体素的光栅顺序编号，结果与厚片划分无关
+    sort(out.begin(), out.end(), [](const VolumeRecord& a, const VolumeRecord& b) { return a.first < b.first; });
+    for (size_t i = 0; i < out.size(); ++i) out[i].label = (int)i + 1;
+    return out;
+}
+
+vector<VolumeRecord> VolumeLabeler::label(const vector<Mat>& slices) {
+    if (slices.empty() || slices[0].empty()) {
+        cerr << "输入体数据为空" << endl;
+        return {};
+    }
+    return label(slices[0].rows, slices[0].cols, (int)slices.size(), [&](int z, Mat& slice) {
+        slice = slices[z];
+        return true;
+    });
+}
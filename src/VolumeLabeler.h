@@ -0,0 +1,94 @@
+﻿#pragma once
+#include "RunLengthLabels.h"
+#include "ThreadPool.h"
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+// 三维连通域的统计记录：体素数与外接长方体（闭区间）
+struct VolumeRecord {
+    int label = 0;
+    int64_t volume = 0;
+    int left = INT_MAX, top = INT_MAX, front = INT_MAX;  // x、y、z 最小值
+    int right = -1, bottom = -1, back = -1;             // x、y、z 最大值
+    int64_t first = INT64_MAX;                          // 光栅顺序首体素下标 (z * rows + y) * cols + x
+
+    void addRun(int z, int y, int x0, int x1, int rows, int cols) {
+        volume += x1 - x0;
+        left = std::min(left, x0);
+        right = std::max(right, x1 - 1);
+        top = std::min(top, y);
+        bottom = std::max(bottom, y);
+        front = std::min(front, z);
+        back = std::max(back, z);
+        first = std::min(first, ((int64_t)z * rows + y) * cols + x0);
+    }
+
+    void merge(const VolumeRecord& o) {
+        volume += o.volume;
+        left = std::min(left, o.left);
+        right = std::max(right, o.right);
+        top = std::min(top, o.top);
+        bottom = std::max(bottom, o.bottom);
+        front = std::min(front, o.front);
+        back = std::max(back, o.back);
+        first = std::min(first, o.first);
+    }
+};
+
+// 三维体数据（CT、显微切片栈）的连通域标记，支持 6、18、26 邻域。
+// 沿用 ConnectedComponentsUF 的并查集思路，但以切片为单位流式处理：每张切片先提取游程，
+// 在并查集上合并切片内相邻行以及与上一切片相邻的游程，因此任何时刻只保留上一切片与当前切片
+// 两层游程形式的临时标签；不再与当前切片相连的连通域立即结算。
+// 多核时沿 z 轴切成若干厚片（slab）并行处理，厚片内部结束的连通域直接输出，
+// 触及厚片上下表面的连通域连同表面游程一起保留，最后在相邻厚片的接触面上合并。
+// 输出按首体素的光栅顺序编号（与逐体素扫描的并查集结果一致），与线程数无关。
+class VolumeLabeler {
+public:
+    // 读取第 z 张切片（CV_8UC1，255 为前景）；多线程时会被并发调用、z 各不相同。返回 false 表示读取失败
+    using SliceReader = std::function<bool(int z, cv::Mat& slice)>;
+
+    // 6（面相邻）、18（面或棱相邻）、26（面、棱或角相邻），默认 6
+    void setConnectivity(int connectivity);
+    int connectivity() const { return m_connectivity; }
+    // 体素数小于 minSize 的连通域不输出
+    void setMinSize(int64_t minSize) { m_minSize = minSize; }
+    // 线程数（即厚片数上限），<= 0 表示使用全部硬件线程
+    void setNumThreads(int numThreads);
+
+    // 标记 depth 张 rows x cols 的切片，返回按编号排序的连通域记录；失败时返回空
+    std::vector<VolumeRecord> label(int rows, int cols, int depth, const SliceReader& reader);
+    // 便利接口：内存中的切片序列
+    std::vector<VolumeRecord> label(const std::vector<cv::Mat>& slices);
+
+    // 各厚片处理过程中同时活跃的连通域数峰值（取最大者），用于确认内存上界
+    int peakLiveComponents() const { return m_peakLive; }
+
+private:
+    // 活跃连通域；face 为其在所在厚片顶面连通域表中的下标，未触及顶面时为 -1
+    struct Live {
+        VolumeRecord rec;
+        int face = -1;
+    };
+
+    // 单个厚片 [z0, z1) 的结果
+    struct Slab {
+        int z0 = 0, z1 = 0;
+        bool ok = true;
+        std::vector<VolumeRecord> done;      // 完全在厚片内部结束的连通域
+        std::vector<VolumeRecord> boundary;  // 触及上下表面、需要跨厚片合并的连通域
+        RunLengthLabels topFace, bottomFace;  // 表面切片的游程，label 为 boundary 下标
+        int peakLive = 0;
+    };
+
+    void labelSlab(int rows, int cols, int depth, const SliceReader& reader, Slab& slab) const;
+
+    std::unique_ptr<ThreadPool> m_pool;
+    int m_connectivity = 6;
+    int64_t m_minSize = 0;
+    int m_peakLive = 0;
+};
@@ -0,0 +1,369 @@
+﻿#include "Benchmark.h"
+#include "SyntheticImages.h"
+#include "ConnectedComponentsBFS.h"
+#include "ConnectedComponentsUF.h"
+#include "ConnectedComponentsBBDT.h"
+#include "ConnectedComponentsParallel.h"
+#include "ConnectedComponentsRLE.h"
+#include "ConnectedComponentsAuto.h"
+#include "ConnectedComponentsIncremental.h"
+#include "VolumeLabeler.h"
+#include "StreamingLabeler.h"
+#include <algorithm>
+#include <deque>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <tuple>
+#include <vector>
+
+// cc_bench：在确定性的合成图像上对所有检测器做重复计时，输出 CSV/JSON 以便跨构建比较。
+// 用法：cc_bench [--sizes 512,1024] [--warmup N] [--reps N] [--min-size N]
+//               [--threads N] [--filter 子串] [--csv 文件] [--json 文件]
+//       cc_bench --verify [--sizes 512,1024] [--min-size N] [--threads N]
+// --verify 不计时，只校验增量标记、流式标记与三维标记这些不经由单图对比路径覆盖的实现，有不一致时返回非 0
+
+static std::vector<std::unique_ptr<IComponentDetector>> makeDetectors(int numThreads) {
+    std::vector<std::unique_ptr<IComponentDetector>> detectors;
+    for (bool eight : {false, true}) {
+        auto bfs = std::make_unique<ConnectedComponentsBFS>();
+        bfs->setEightConnectivity(eight);
+        auto uf = std::make_unique<ConnectedComponentsUF>();
+        uf->setEightConnectivity(eight);
+        auto bbdt = std::make_unique<ConnectedComponentsBBDT>();
+        bbdt->setEightConnectivity(eight);
+        auto par = std::make_unique<ConnectedComponentsParallel>();
+        par->setEightConnectivity(eight);
+        par->setNumThreads(numThreads);
+        auto rle = std::make_unique<ConnectedComponentsRLE>();
+        rle->setEightConnectivity(eight);
+        auto autoSelect = std::make_unique<ConnectedComponentsAuto>();
+        autoSelect->setEightConnectivity(eight);
+        autoSelect->setNumThreads(numThreads);
+        detectors.push_back(std::move(bfs));
+        detectors.push_back(std::move(uf));
+        detectors.push_back(std::move(bbdt));
+        detectors.push_back(std::move(par));
+        detectors.push_back(std::move(rle));
+        detectors.push_back(std::move(autoSelect));
+    }
+    return detectors;
+}
+
+// 两幅标记图的划分是否相同（标签之间一一对应），map 输出 a 的标签到 b 的标签
+static bool samePartition(const cv::Mat& a, const cv::Mat& b, std::vector<int>& map) {
+    if (a.size() != b.size() || a.type() != CV_32S || b.type() != CV_32S) return false;
+    auto maxLabel = [](const cv::Mat& m) {
+        int v = 0;
+        for (int y = 0; y < m.rows; ++y) v = std::max(v, *std::max_element(m.ptr<int>(y), m.ptr<int>(y) + m.cols));
+        return v;
+    };
+    map.assign(maxLabel(a) + 1, -1);
+    std::vector<int> inverse(maxLabel(b) + 1, -1);
+    for (int y = 0; y < a.rows; ++y) {
+        const int* pa = a.ptr<int>(y);
+        const int* pb = b.ptr<int>(y);
+        for (int x = 0; x < a.cols; ++x) {
+            if ((pa[x] == 0) != (pb[x] == 0)) return false;
+            if (pa[x] == 0) continue;
+            if (map[pa[x]] < 0) map[pa[x]] = pb[x];
+            if (inverse[pb[x]] < 0) inverse[pb[x]] = pa[x];
+            if (map[pa[x]] != pb[x] || inverse[pb[x]] != pa[x]) return false;
+        }
+    }
+    return true;
+}
+
+// 标签对应关系是否为恒等映射，即两幅标记图完全相同
+static bool isIdentity(const std::vector<int>& map) {
+    for (size_t l = 1; l < map.size(); ++l)
+        if (map[l] >= 0 && map[l] != (int)l) return false;
+    return true;
+}
+
+// 按标签对应关系逐项比较统计表（含周长）
+static bool sameStats(const ComponentStats& a, const ComponentStats& b, const std::vector<int>& map) {
+    for (size_t la = 1; la < map.size(); ++la) {
+        const int lb = map[la];
+        if (lb < 0) continue;
+        if (a.area[la] != b.area[lb] || a.left[la] != b.left[lb] || a.top[la] != b.top[lb] || a.right[la] != b.right[lb] ||
+            a.bottom[la] != b.bottom[lb] || a.m10[la] != b.m10[lb] || a.m01[la] != b.m01[lb] ||
+            a.perimeter[la] != b.perimeter[lb])
+            return false;
+    }
+    return true;
+}
+
+// 首帧的稳定编号（未做 minSize 过滤）与不过滤的 UF 完全相同；过滤后的输出保留编号空缺，不与 UF 逐值比较
+static bool sameFirstFrame(const ConnectedComponentsIncremental& inc, ConnectedComponentsUF& uf, const cv::Mat& frame) {
+    cv::Mat full;
+    std::vector<int> map;
+    uf.detectInto(frame, full, 0);
+    return samePartition(inc.labels(), full, map) && isIdentity(map);
+}
+
+// 在上一帧上随机改写几个小矩形（加噪或清空），偶尔画一条贯穿的横线制造大范围合并
+static void perturb(cv::Mat& frame, std::mt19937& rng) {
+    for (int k = 0; k < 3; ++k) {
+        const int w = 1 + rng() % std::min(40, frame.cols), h = 1 + rng() % std::min(40, frame.rows);
+        const cv::Rect r(rng() % (frame.cols - w + 1), rng() % (frame.rows - h + 1), w, h);
+        const bool clear = rng() % 3 == 0;
+        for (int y = r.y; y < r.y + r.height; ++y)
+            for (int x = r.x; x < r.x + r.width; ++x) frame.at<uchar>(y, x) = !clear && rng() % 2 ? 255 : 0;
+    }
+    if (rng() % 4 == 0) frame.row(rng() % frame.rows).setTo(255);
+}
+
+// 增量标记：扰动的合成帧序列逐帧与整幅重新标记比较划分与统计量；首帧还要求编号与 UF 完全相同
+static bool verifyIncremental(const std::vector<int>& sizes, int minSize) {
+    const int kFrames = 12;
+    bool allOk = true;
+    for (int size : sizes) {
+        for (const auto& c : SyntheticImages::standardSuite(size, size)) {
+            for (bool eight : {false, true}) {
+                ConnectedComponentsIncremental inc;
+                inc.setEightConnectivity(eight);
+                ConnectedComponentsUF uf;
+                uf.setEightConnectivity(eight);
+                std::mt19937 rng(size);
+                cv::Mat frame = c.binary.clone(), labels, ref;
+                ComponentStats stats, refStats;
+                std::vector<int> map;
+                int failedFrame = -1;
+                for (int f = 0; f < kFrames && failedFrame < 0; ++f) {
+                    if (f > 0) perturb(frame, rng);
+                    inc.detectInto(frame, labels, minSize, &stats, true);
+                    uf.detectInto(frame, ref, minSize, &refStats, true);
+                    const bool ok = inc.numComponents() == uf.numComponents() && samePartition(labels, ref, map) &&
+                                    sameStats(stats, refStats, map) &&
+                                    (f > 0 || sameFirstFrame(inc, uf, frame));
+                    if (!ok) failedFrame = f;
+                }
+                std::cout << std::left << std::setw(24) << c.name << std::setw(24) << inc.name()
+                          << (failedFrame < 0 ? "一致" : "第 " + std::to_string(failedFrame) + " 帧不一致") << std::endl;
+                allOk = allOk && failedFrame < 0;
+            }
+        }
+    }
+    return allOk;
+}
+
+// 流式标记：不同数据带高度下输出的记录与 UF 统计表作为多重集比较（输出按完成先后编号，与 UF 顺序不同），
+// 并要求编号从 1 连续、返回值等于输出个数；宽度不符的数据带须返回 -1
+static bool verifyStreaming(const std::vector<int>& sizes, int minSize) {
+    using Key = std::tuple<int, int, int, int, int, int64_t, int64_t>;
+    bool allOk = true;
+    for (int size : sizes) {
+        for (const auto& c : SyntheticImages::standardSuite(size, size)) {
+            for (bool eight : {false, true}) {
+                ConnectedComponentsUF uf;
+                uf.setEightConnectivity(eight);
+                cv::Mat ref;
+                ComponentStats refStats;
+                uf.detectInto(c.binary, ref, minSize, &refStats);
+                std::vector<Key> expected;
+                for (int l = 1; l <= refStats.numComponents(); ++l)
+                    expected.emplace_back(refStats.area[l], refStats.left[l], refStats.top[l], refStats.right[l],
+                                          refStats.bottom[l], refStats.m10[l], refStats.m01[l]);
+                std::sort(expected.begin(), expected.end());
+
+                std::string failed;
+                for (int bandRows : {1, 7, 64, size}) {
+                    StreamingLabeler streaming;
+                    streaming.setEightConnectivity(eight);
+                    streaming.setMinSize(minSize);
+                    std::vector<Key> got;
+                    bool ordered = true;
+                    const int n = streaming.run(c.binary, [&](const ComponentRecord& r) {
+                        ordered = ordered && r.label == (int)got.size() + 1;
+                        got.emplace_back(r.area, r.left, r.top, r.right, r.bottom, r.m10, r.m01);
+                    }, bandRows);
+                    std::sort(got.begin(), got.end());
+                    if (!ordered || n != (int)got.size() || got != expected) {
+                        failed = "数据带 " + std::to_string(bandRows) + " 行不一致";
+                        break;
+                    }
+                }
+                if (failed.empty()) {
+                    // 第二条数据带宽度不符：不能把截断的图像当作完整结果返回
+                    StreamingLabeler streaming;
+                    streaming.setEightConnectivity(eight);
+                    int bands = 0;
+                    const int n = streaming.run(c.binary.cols, [&](cv::Mat& band) {
+                        if (bands == 2) return false;
+                        if (bands++ == 0) band = c.binary.rowRange(0, c.binary.rows / 2);
+                        else band = cv::Mat(1, c.binary.cols + 1, CV_8UC1, cv::Scalar(0));
+                        return true;
+                    }, nullptr);
+                    if (n != -1) failed = "截断输入未报错";
+                }
+                std::cout << std::left << std::setw(24) << c.name << std::setw(24)
+                          << (eight ? "Streaming (8)" : "Streaming (4)") << (failed.empty() ? "一致" : failed)
+                          << std::endl;
+                allOk = allOk && failed.empty();
+            }
+        }
+    }
+    return allOk;
+}
+
+// 三维逐体素洪水填充，作为 VolumeLabeler 的基准：按光栅顺序找种子，编号即首体素顺序
+static std::vector<VolumeRecord> floodFill3D(const std::vector<cv::Mat>& slices, int connectivity, int64_t minSize) {
+    const int depth = (int)slices.size(), rows = slices[0].rows, cols = slices[0].cols;
+    std::vector<cv::Point3i> offsets;
+    for (int dz = -1; dz <= 1; ++dz)
+        for (int dy = -1; dy <= 1; ++dy)
+            for (int dx = -1; dx <= 1; ++dx) {
+                const int n = std::abs(dx) + std::abs(dy) + std::abs(dz);
+                if (n > 0 && (connectivity == 26 || (connectivity == 18 && n <= 2) || n == 1)) offsets.emplace_back(dx, dy, dz);
+            }
+    std::vector<char> visited((size_t)depth * rows * cols, 0);
+    auto index = [&](int z, int y, int x) { return ((size_t)z * rows + y) * cols + x; };
+    std::vector<VolumeRecord> out;
+    std::deque<cv::Point3i> queue;
+    for (int z = 0; z < depth; ++z)
+        for (int y = 0; y < rows; ++y)
+            for (int x = 0; x < cols; ++x) {
+                if (slices[z].at<uchar>(y, x) != 255 || visited[index(z, y, x)]) continue;
+                VolumeRecord rec;
+                visited[index(z, y, x)] = 1;
+                queue.emplace_back(x, y, z);
+                while (!queue.empty()) {
+                    const cv::Point3i p = queue.front();
+                    queue.pop_front();
+                    rec.addRun(p.z, p.y, p.x, p.x + 1, rows, cols);
+                    for (const cv::Point3i& d : offsets) {
+                        const int nx = p.x + d.x, ny = p.y + d.y, nz = p.z + d.z;
+                        if (nx < 0 || ny < 0 || nz < 0 || nx >= cols || ny >= rows || nz >= depth) continue;
+                        if (slices[nz].at<uchar>(ny, nx) != 255 || visited[index(nz, ny, nx)]) continue;
+                        visited[index(nz, ny, nx)] = 1;
+                        queue.emplace_back(nx, ny, nz);
+                    }
+                }
+                if (rec.volume < minSize) continue;
+                rec.label = (int)out.size() + 1;
+                out.push_back(rec);
+            }
+    return out;
+}
+
+static bool sameRecords(const std::vector<VolumeRecord>& a, const std::vector<VolumeRecord>& b) {
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); ++i) {
+        const VolumeRecord &p = a[i], &q = b[i];
+        if (p.label != q.label || p.volume != q.volume || p.first != q.first || p.left != q.left || p.right != q.right ||
+            p.top != q.top || p.bottom != q.bottom || p.front != q.front || p.back != q.back)
+            return false;
+    }
+    return true;
+}
+
+// 三维标记：小体数据上分别用 1 个与多个线程、6/18/26 邻域，与逐体素洪水填充逐项比较
+static bool verifyVolume(int minSize, int numThreads) {
+    const int kRows = 40, kCols = 56, kDepth = 24;
+    struct Stack {
+        std::string name;
+        std::vector<cv::Mat> slices;
+    };
+    std::vector<Stack> stacks(3);
+    stacks[0].name = "noise20";
+    stacks[1].name = "noise35";
+    stacks[2].name = "blobs";
+    for (int z = 0; z < kDepth; ++z) {
+        stacks[0].slices.push_back(SyntheticImages::noise(kRows, kCols, 0.2, 100 + z));
+        stacks[1].slices.push_back(SyntheticImages::noise(kRows, kCols, 0.35, 200 + z));
+        // 相邻两张切片相同，斑块沿 z 方向延伸
+        stacks[2].slices.push_back(SyntheticImages::blobs(kRows, kCols, 12, 6, 300 + z / 2));
+    }
+    const int threads = numThreads > 1 ? numThreads : 4;
+    bool allOk = true;
+    for (const Stack& s : stacks) {
+        for (int connectivity : {6, 18, 26}) {
+            const std::vector<VolumeRecord> ref = floodFill3D(s.slices, connectivity, minSize);
+            for (int t : {1, threads}) {
+                VolumeLabeler labeler;
+                labeler.setConnectivity(connectivity);
+                labeler.setMinSize(minSize);
+                labeler.setNumThreads(t);
+                const bool ok = sameRecords(labeler.label(s.slices), ref);
+                std::cout << std::left << std::setw(24) << s.name + "_" + std::to_string(kDepth) + "x" + std::to_string(kRows) + "x" + std::to_string(kCols)
+                          << std::setw(24) << "Volume (" + std::to_string(connectivity) + ", " + std::to_string(t) + " 线程)"
+                          << (ok ? "一致" : "不一致") << std::endl;
+                allOk = allOk && ok;
+            }
+        }
+    }
+    return allOk;
+}
+
+static std::vector<int> parseSizes(const std::string& s) {
+    std::vector<int> sizes;
+    std::stringstream ss(s);
+    std::string item;
+    while (std::getline(ss, item, ','))
+        if (!item.empty()) sizes.push_back(std::stoi(item));
+    return sizes;
+}
+
+int main(int argc, char** argv) {
+    Benchmark::Options options;
+    std::vector<int> sizes = {512, 1024};
+    int numThreads = 0;
+    std::string filter, csvPath, jsonPath;
+    bool verify = false;
+
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        const bool hasValue = i + 1 < argc;
+        if (arg == "--sizes" && hasValue) sizes = parseSizes(argv[++i]);
+        else if (arg == "--warmup" && hasValue) options.warmup = std::stoi(argv[++i]);
+        else if (arg == "--reps" && hasValue) options.repetitions = std::stoi(argv[++i]);
+        else if (arg == "--min-size" && hasValue) options.minSize = std::stoi(argv[++i]);
+        else if (arg == "--threads" && hasValue) numThreads = std::stoi(argv[++i]);
+        else if (arg == "--filter" && hasValue) filter = argv[++i];
+        else if (arg == "--csv" && hasValue) csvPath = argv[++i];
+        else if (arg == "--json" && hasValue) jsonPath = argv[++i];
+        else if (arg == "--verify") verify = true;
+        else {
+            std::cerr << "未知参数: " << arg << std::endl;
+            std::cerr << "用法: cc_bench [--sizes 512,1024] [--warmup N] [--reps N] [--min-size N] "
+                         "[--threads N] [--filter 子串] [--csv 文件] [--json 文件] [--verify]" << std::endl;
+            return -1;
+        }
+    }
+    if (verify) {
+        const bool incrementalOk = verifyIncremental(sizes, options.minSize);
+        const bool streamingOk = verifyStreaming(sizes, options.minSize);
+        const bool volumeOk = verifyVolume(options.minSize, numThreads);
+        return incrementalOk && streamingOk && volumeOk ? 0 : 1;
+    }
+
+    auto detectors = makeDetectors(numThreads);
+    std::vector<Benchmark::Result> results;
+
+    std::cout << std::left << std::setw(24) << "图像" << std::setw(24) << "算法" << std::right
+              << std::setw(10) << "连通域数" << std::setw(12) << "中位(ms)" << std::setw(12) << "p95(ms)"
+              << std::setw(12) << "p99(ms)" << std::setw(12) << "MPix/s" << std::endl;
+
+    for (int size : sizes) {
+        for (const auto& c : SyntheticImages::standardSuite(size, size)) {
+            for (const auto& detector : detectors) {
+                if (!filter.empty() && detector->name().find(filter) == std::string::npos) continue;
+                const Benchmark::Result r = Benchmark::run(*detector, c.name, c.binary, options);
+                results.push_back(r);
+                std::cout << std::left << std::setw(24) << r.image << std::setw(24) << r.detector << std::right
+                          << std::setw(10) << r.numComponents << std::fixed << std::setprecision(3)
+                          << std::setw(12) << r.medianMs << std::setw(12) << r.p95Ms << std::setw(12) << r.p99Ms
+                          << std::setprecision(1) << std::setw(12) << r.mpixPerSec << std::endl;
+            }
+        }
+    }
+
+    std::cout << "进程峰值 RSS: " << Benchmark::peakRssKb() << " KB" << std::endl;
+    if (!csvPath.empty() && Benchmark::writeCsv(csvPath, results)) std::cout << "结果已保存: " << csvPath << std::endl;
+    if (!jsonPath.empty() && Benchmark::writeJson(jsonPath, results, options)) std::cout << "结果已保存: " << jsonPath << std::endl;
+    return 0;
+}
@@ -0,0 +1,163 @@
+﻿#include "Benchmark.h"
+#include "LabelClient.h"
+#include "SyntheticImages.h"
+#include "ConnectedComponentsUF.h"
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// cc_loadgen：向 cc_label --serve 施加负载，统计客户端视角的端到端延迟与吞吐。
+// 每个客户端线程一个连接，最多 inflight 个请求同时在途（每个在途请求占一个共享内存槽）；
+// 帧按顺序轮流取自合成用例集，写入槽的时间计入延迟。
+// 用法：cc_loadgen --socket 路径 [--clients N] [--requests N] [--size N] [--inflight N]
+//                  [--eight] [--stats] [--labels16] [--verify]
+
+using namespace LabelProtocol;
+
+struct ClientResult {
+    std::vector<double> latencyMs;
+    double serviceMsTotal = 0, queueMsTotal = 0;
+    int errors = 0, mismatches = 0;
+};
+
+static void runClient(const std::string& socketPath, const std::vector<SyntheticImages::Case>& frames,
+                      const std::vector<int>& expected, int requests, int inflight, uint32_t flags, ClientResult& result) {
+    const int rows = frames[0].binary.rows, cols = frames[0].binary.cols;
+    const int maxComponents = (flags & kWantStats) ? rows * cols / 2 + 1 : 0;
+    LabelClient client;
+    if (!client.connect(socketPath, inflight, LabelClient::slotBytesFor(rows, cols, maxComponents))) {
+        result.errors = requests;
+        return;
+    }
+    using Clock = std::chrono::steady_clock;
+    std::vector<Clock::time_point> sentAt(inflight);
+    std::vector<int> frameOf(inflight);
+    std::vector<int> freeSlots;
+    for (int s = inflight - 1; s >= 0; --s) freeSlots.push_back(s);
+    result.latencyMs.reserve(requests);
+
+    int sent = 0, received = 0;
+    while (received < requests) {
+        while (sent < requests && !freeSlots.empty()) {
+            const int slot = freeSlots.back();
+            freeSlots.pop_back();
+            frameOf[slot] = sent % (int)frames.size();
+            sentAt[slot] = Clock::now();
+            cv::Mat frame = client.input(slot, rows, cols);
+            frames[frameOf[slot]].binary.copyTo(frame);
+            if (!client.submit(slot, rows, cols, 0, flags)) {
+                result.errors += requests - received;
+                return;
+            }
+            ++sent;
+        }
+        Reply reply;
+        if (!client.wait(reply)) {
+            result.errors += requests - received;
+            return;
+        }
+        const int slot = (int)reply.slot;
+        ++received;
+        freeSlots.push_back(slot);
+        if (reply.status != kOk) {
+            ++result.errors;
+            continue;
+        }
+        result.latencyMs.push_back(std::chrono::duration<double, std::milli>(Clock::now() - sentAt[slot]).count());
+        result.serviceMsTotal += reply.serviceMs;
+        result.queueMsTotal += reply.queueMs;
+        if (!expected.empty() && reply.numComponents != expected[frameOf[slot]]) ++result.mismatches;
+    }
+}
+
+int main(int argc, char** argv) {
+    std::string socketPath;
+    int clients = 1, requests = 1000, size = 512, inflight = 2;
+    uint32_t flags = kWantLabels;
+    bool verify = false;
+
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        const bool hasValue = i + 1 < argc;
+        if (arg == "--socket" && hasValue) socketPath = argv[++i];
+        else if (arg == "--clients" && hasValue) clients = std::max(std::stoi(argv[++i]), 1);
+        else if (arg == "--requests" && hasValue) requests = std::max(std::stoi(argv[++i]), 1);
+        else if (arg == "--size" && hasValue) size = std::max(std::stoi(argv[++i]), 1);
+        else if (arg == "--inflight" && hasValue) inflight = std::max(std::stoi(argv[++i]), 1);
+        else if (arg == "--eight") flags |= kEightConnectivity;
+        else if (arg == "--stats") flags |= kWantStats;
+        else if (arg == "--labels16") flags |= kLabels16;
+        else if (arg == "--verify") verify = true;
+        else {
+            std::cerr << "未知参数: " << arg << std::endl;
+            std::cerr << "用法: cc_loadgen --socket 路径 [--clients N] [--requests N] [--size N] [--inflight N] "
+                         "[--eight] [--stats] [--labels16] [--verify]" << std::endl;
+            return -1;
+        }
+    }
+    if (socketPath.empty()) {
+        std::cerr << "缺少 --socket" << std::endl;
+        return -1;
+    }
+
+    const auto frames = SyntheticImages::standardSuite(size, size);
+    // 校验时先在本地标记一遍，作为每帧连通域数的基准
+    std::vector<int> expected;
+    if (verify) {
+        ConnectedComponentsUF uf;
+        uf.setEightConnectivity(flags & kEightConnectivity);
+        for (const auto& c : frames) {
+            uf.detect(c.binary, 0);
+            expected.push_back(uf.numComponents());
+        }
+    }
+
+    std::vector<ClientResult> results(clients);
+    std::vector<std::thread> threads;
+    const auto start = std::chrono::steady_clock::now();
+    for (int c = 0; c < clients; ++c)
+        threads.emplace_back(runClient, std::cref(socketPath), std::cref(frames), std::cref(expected), requests, inflight,
+                             flags, std::ref(results[c]));
+    for (auto& t : threads) t.join();
+    const double wallSec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::vector<double> latencies;
+    double serviceMs = 0, queueMs = 0;
+    int errors = 0, mismatches = 0;
+    for (const auto& r : results) {
+        latencies.insert(latencies.end(), r.latencyMs.begin(), r.latencyMs.end());
+        serviceMs += r.serviceMsTotal;
+        queueMs += r.queueMsTotal;
+        errors += r.errors;
+        mismatches += r.mismatches;
+    }
+    if (latencies.empty()) {
+        std::cerr << "没有成功的请求（" << errors << " 个失败）" << std::endl;
+        return 1;
+    }
+    std::sort(latencies.begin(), latencies.end());
+    const double n = (double)latencies.size();
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << clients << " 个客户端 x " << requests << " 个请求，" << size << "x" << size << "，每连接在途 " << inflight
+              << "，失败 " << errors << std::endl;
+    std::cout << "吞吐 " << std::setprecision(1) << n / wallSec << " 帧/s，" << n * size * size / wallSec / 1e6
+              << " MPix/s" << std::setprecision(3) << std::endl;
+    std::cout << "端到端延迟 p50 " << Benchmark::percentile(latencies, 50) << " ms，p95 "
+              << Benchmark::percentile(latencies, 95) << " ms，p99 " << Benchmark::percentile(latencies, 99)
+              << " ms，最大 " << latencies.back() << " ms" << std::endl;
+    std::cout << "服务端平均 处理 " << serviceMs / n << " ms，排队 " << queueMs / n << " ms" << std::endl;
+    if (verify) std::cout << "连通域数与本地结果不一致: " << mismatches << std::endl;
+
+    // 服务端累计的分位数（含其他客户端的请求）
+    LabelClient client;
+    Reply reply;
+    if (client.connect(socketPath, 1, 64) && client.queryLatency(reply))
+        std::cout << "服务端累计 " << reply.served << " 个请求，p50 " << reply.p50Ms << " ms，p95 " << reply.p95Ms
+                  << " ms，p99 " << reply.p99Ms << " ms，最大 " << reply.maxMs << " ms" << std::endl;
+    return (errors || mismatches) ? 1 : 0;
+}
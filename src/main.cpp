@@ -1,7 +1,28 @@
-﻿#include "ComponentEvaluator.h"
+﻿#include "BatchPipeline.h"
+#include "ComponentEvaluator.h"
 #include "ConnectedComponentsBFS.h"
 #include "ConnectedComponentsUF.h"
+#include "ConnectedComponentsBBDT.h"
+#include "ConnectedComponentsParallel.h"
+#include "ConnectedComponentsRLE.h"
+#include "ConnectedComponentsAuto.h"
+#include "ComponentTree.h"
+#include "SparseLabeler.h"
+#include "LabelMapIO.h"
+#ifdef CC_HAVE_LABEL_SERVER
+#include "LabelServer.h"
+#include <csignal>
+#endif
+#ifdef CC_HAVE_MMAP
+#include "OutOfCoreLabeler.h"
+#include "Benchmark.h"
+#endif
 #include <opencv2/opencv.hpp>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <sstream>
 #include <vector>
 #include <filesystem>
 
@@ -10,9 +31,296 @@
 // 要求：
 // 1. opencv & c/c++， 可以上网查阅资料，但代码要自己独立实现
 // 2. 用自己算法实现，不可以用opencv的轮廓提取、填充功能（因为它不够准确）
+
+// 按名称创建检测器：bfs / uf / bbdt / parallel / rle / auto
+static std::unique_ptr<IComponentDetector> makeDetector(const std::string& name, bool eight) {
+    if (name == "bfs") { auto d = std::make_unique<ConnectedComponentsBFS>(); d->setEightConnectivity(eight); return d; }
+    if (name == "uf") { auto d = std::make_unique<ConnectedComponentsUF>(); d->setEightConnectivity(eight); return d; }
+    if (name == "parallel") { auto d = std::make_unique<ConnectedComponentsParallel>(); d->setEightConnectivity(eight); return d; }
+    if (name == "rle") { auto d = std::make_unique<ConnectedComponentsRLE>(); d->setEightConnectivity(eight); return d; }
+    if (name == "bbdt") { auto d = std::make_unique<ConnectedComponentsBBDT>(); d->setEightConnectivity(eight); return d; }
+    if (name == "auto") { auto d = std::make_unique<ConnectedComponentsAuto>(); d->setEightConnectivity(eight); return d; }
+    return nullptr;
+}
+
+// 输出格式：png（彩色图）/ rle（游程标记图 .ccl）/ raw（原始标记图 .raw）
+static bool parseFormat(const std::string& name, BatchPipeline::OutputFormat& format) {
+    if (name == "png") format = BatchPipeline::kColorPng;
+    else if (name == "rle") format = BatchPipeline::kLabelsRle;
+    else if (name == "raw") format = BatchPipeline::kLabelsRaw;
+    else {
+        std::cerr << "未知输出格式: " << name << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// 批处理模式：cc_label --batch <目录|列表文件> [--out 目录] [--workers 解码,预处理,标记,编码,写盘]
+//                      [--queue N] [--detector bbdt] [--eight] [--min-size N] [--fused] [--format png|rle|raw]
+// --fused 将二值化、闭运算与游程提取逐行融合，隐含 --detector rle
+static int runBatch(int argc, char** argv) {
+    std::string input, detectorName = "bbdt";
+    bool eight = false;
+    BatchPipeline::Options options;
+    options.outputDir = "result";
+
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        const bool hasValue = i + 1 < argc;
+        if (arg == "--batch" && hasValue) input = argv[++i];
+        else if (arg == "--out" && hasValue) options.outputDir = argv[++i];
+        else if (arg == "--queue" && hasValue) options.queueCapacity = (size_t)std::stoi(argv[++i]);
+        else if (arg == "--detector" && hasValue) detectorName = argv[++i];
+        else if (arg == "--min-size" && hasValue) options.minSize = std::stoi(argv[++i]);
+        else if (arg == "--eight") eight = true;
+        else if (arg == "--fused") options.fused = true;
+        else if (arg == "--format" && hasValue) {
+            if (!parseFormat(argv[++i], options.format)) return -1;
+        }
+        else if (arg == "--workers" && hasValue) {
+            std::stringstream ss(argv[++i]);
+            std::string item;
+            for (int s = 0; s < BatchPipeline::kNumStages && std::getline(ss, item, ','); ++s) options.workers[s] = std::stoi(item);
+        } else {
+            std::cerr << "未知参数: " << arg << std::endl;
+            return -1;
+        }
+    }
+    if (options.fused) detectorName = "rle";
+    if (!makeDetector(detectorName, eight)) {
+        std::cerr << "未知检测器: " << detectorName << std::endl;
+        return -1;
+    }
+
+    const std::vector<std::string> inputs = BatchPipeline::collectInputs(input);
+    if (inputs.empty()) {
+        std::cerr << "没有可处理的图像: " << input << std::endl;
+        return -1;
+    }
+    std::cout << "批处理 " << inputs.size() << " 张图像，输出目录: " << options.outputDir << std::endl;
+
+    auto summary = BatchPipeline::run(inputs, [&] { return makeDetector(detectorName, eight); }, options);
+    BatchPipeline::printSummary(summary);
+    return summary.failed ? 1 : 0;
+}
+
+// 稀疏输入模式：cc_label --sparse <坐标文件> [--eight] [--min-size N]
+// 坐标文件每行一个前景像素 "x y"，不需要知道也不分配整幅图像
+static int runSparse(int argc, char** argv) {
+    std::string input;
+    SparseLabeler labeler;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        const bool hasValue = i + 1 < argc;
+        if (arg == "--sparse" && hasValue) input = argv[++i];
+        else if (arg == "--eight") labeler.setEightConnectivity(true);
+        else if (arg == "--min-size" && hasValue) labeler.setMinSize(std::stoi(argv[++i]));
+        else {
+            std::cerr << "未知参数: " << arg << std::endl;
+            return -1;
+        }
+    }
+    std::ifstream in(input);
+    if (!in) {
+        std::cerr << "无法读取文件: " << input << std::endl;
+        return -1;
+    }
+    std::vector<cv::Point> points;
+    cv::Point p;
+    while (in >> p.x >> p.y) points.push_back(p);
+
+    auto start = std::chrono::steady_clock::now();
+    const int count = labeler.label(points);
+    const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::cout << points.size() << " 个前景像素，" << labeler.runs().size() << " 个游程，" << count << " 个连通域，耗时 "
+              << std::fixed << std::setprecision(2) << ms << " ms" << std::endl;
+    std::cout << "标签\t面积\t外接矩形(x,y,w,h)\t质心" << std::endl;
+    for (const ComponentRecord& rec : labeler.components()) {
+        const cv::Rect box = rec.bbox();
+        std::cout << rec.label << "\t" << rec.area << "\t" << box.x << "," << box.y << "," << box.width << "," << box.height
+                  << "\t" << rec.cx() << "," << rec.cy() << std::endl;
+    }
+    return 0;
+}
+
+#ifdef CC_HAVE_LABEL_SERVER
+// 服务模式：cc_label --serve <套接字路径> [--workers N] [--queue N] [--detector bbdt]
+// 常驻运行直到收到 SIGINT/SIGTERM，退出前打印请求延迟分位数；客户端见 LabelClient 与 cc_loadgen
+static int runServe(int argc, char** argv) {
+    LabelServer::Options options;
+    std::string detectorName = "bbdt";
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        const bool hasValue = i + 1 < argc;
+        if (arg == "--serve" && hasValue) options.socketPath = argv[++i];
+        else if (arg == "--workers" && hasValue) options.workers = std::stoi(argv[++i]);
+        else if (arg == "--queue" && hasValue) options.queueCapacity = std::stoul(argv[++i]);
+        else if (arg == "--detector" && hasValue) detectorName = argv[++i];
+        else {
+            std::cerr << "未知参数: " << arg << std::endl;
+            return -1;
+        }
+    }
+    if (!makeDetector(detectorName, false)) {
+        std::cerr << "未知检测器: " << detectorName << std::endl;
+        return -1;
+    }
+
+    // 在启动任何线程之前屏蔽信号，由主线程同步等待
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+    LabelServer server([&](bool eight) { return makeDetector(detectorName, eight); }, options);
+    if (!server.start()) return -1;
+    std::cout << "标记服务已启动: " << options.socketPath << "（" << detectorName << "，" << options.workers
+              << " 个工作线程）" << std::endl;
+    int sig = 0;
+    sigwait(&signals, &sig);
+    server.stop();
+    LabelServer::printLatency(server.latency());
+    return 0;
+}
+#endif
+
+#ifdef CC_HAVE_MMAP
+// 解析 "行x列"
+static bool parseSize(const std::string& s, int& rows, int& cols) {
+    return std::sscanf(s.c_str(), "%dx%d", &rows, &cols) == 2 && rows > 0 && cols > 0;
+}
+
+// 外存模式：cc_label --out-of-core <输入> --out 标记.raw [--size 行x列] [--offset 字节] [--tiled 块行x块列]
+//                     [--tile 块行x块列] [--budget MB] [--threshold N] [--eight] [--min-size N]
+// 输入为 .pgm（P5）时从文件头读尺寸，否则按 --size 解释为无文件头的 8 位原始数据；--tiled 表示像素数据分块存储（对两者都适用）；
+// 输出为 LabelMapIO 原始格式，经内存映射逐块带写出，常驻内存受 --budget 约束
+static int runOutOfCore(int argc, char** argv) {
+    OutOfCoreLabeler labeler;
+    OutOfCoreLabeler::Input input;
+    std::string inputPath, outputPath;
+    bool sizeGiven = false;
+    int tiledRows = 0, tiledCols = 0;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        const bool hasValue = i + 1 < argc;
+        int r = 0, c = 0;
+        if (arg == "--out-of-core" && hasValue) inputPath = argv[++i];
+        else if (arg == "--out" && hasValue) outputPath = argv[++i];
+        else if (arg == "--size" && hasValue && parseSize(argv[++i], input.rows, input.cols)) sizeGiven = true;
+        else if (arg == "--offset" && hasValue) input.offset = std::stoull(argv[++i]);
+        else if (arg == "--tiled" && hasValue && parseSize(argv[++i], tiledRows, tiledCols)) {}
+        else if (arg == "--tile" && hasValue && parseSize(argv[++i], r, c)) labeler.setTileSize(r, c);
+        else if (arg == "--budget" && hasValue) labeler.setMemoryBudget((size_t)std::stoull(argv[++i]) << 20);
+        else if (arg == "--threshold" && hasValue) labeler.setThreshold(std::stoi(argv[++i]));
+        else if (arg == "--eight") labeler.setEightConnectivity(true);
+        else if (arg == "--min-size" && hasValue) labeler.setMinSize(std::stoi(argv[++i]));
+        else {
+            std::cerr << "未知参数: " << arg << std::endl;
+            return -1;
+        }
+    }
+    if (inputPath.empty() || outputPath.empty()) {
+        std::cerr << "需要指定输入与 --out" << std::endl;
+        return -1;
+    }
+    if (sizeGiven) {
+        input.path = inputPath;
+    } else if (!OutOfCoreLabeler::probePgm(inputPath, input)) {
+        std::cerr << "非 PGM 输入需要 --size 行x列" << std::endl;
+        return -1;
+    }
+    // probePgm 会重置输入的块尺寸，因此在探测之后再设置
+    input.tileRows = tiledRows;
+    input.tileCols = tiledCols;
+
+    if (!labeler.run(input, outputPath)) return 1;
+    const OutOfCoreLabeler::Report& r = labeler.report();
+    const double totalMs = r.pass1Ms + r.pass2Ms;
+    std::cout << input.rows << "x" << input.cols << "，块 " << r.tileRows << "x" << r.tileCols << "，" << r.numComponents
+              << " 个连通域（跨块临时编号 " << r.borderLabels << "，跨块带延续集合峰值 " << r.peakCarried << "）" << std::endl;
+    std::cout << "第一遍 " << std::fixed << std::setprecision(1) << r.pass1Ms << " ms，第二遍 " << r.pass2Ms << " ms，"
+              << (double)input.rows * input.cols / totalMs / 1e3 << " MPix/s" << std::endl;
+    std::cout << "映射窗口峰值 " << r.windowBytes / 1024 << " KB，块缓冲与等价表峰值 " << r.workingBytes / 1024
+              << " KB，进程峰值 RSS " << Benchmark::peakRssKb() << " KB" << std::endl;
+    std::cout << "结果已保存: " << outputPath << std::endl;
+    return 0;
+}
+#endif
+
+// 把各检测器的分阶段耗时与计数器写成 JSON（插桩未启用时只有总耗时）
+static bool writeProfile(const std::string& path, const std::string& imagePath, const cv::Mat& binary,
+                         const std::vector<ComponentEvaluator::Result>& results) {
+    std::ofstream out(path);
+    if (!out) {
+        std::cerr << "无法写入文件: " << path << std::endl;
+        return false;
+    }
+    std::string image;
+    for (char c : imagePath) {
+        if (c == '"' || c == '\\') image += '\\';
+        image += c;
+    }
+    out << "{\n  \"image\": \"" << image << "\",\n  \"rows\": " << binary.rows << ",\n  \"cols\": " << binary.cols
+        << ",\n  \"instrumentation\": " << (Instrumentation::enabled() ? "true" : "false") << ",\n  \"detectors\": [";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const auto& r = results[i];
+        out << (i ? "," : "") << "\n    {\n      \"name\": \"" << r.name << "\",\n      \"numComponents\": " << r.numComponents
+            << ",\n      \"timeMs\": " << std::fixed << std::setprecision(4) << r.timeMs << ",\n      \"profile\": ";
+        r.profile->writeJson(out, 6);
+        out << "\n    }";
+    }
+    out << "\n  ]\n}\n";
+    return (bool)out;
+}
+
+// 阈值扫描：对闭运算后的灰度图建一棵最大树，一次给出全部 256 个阈值下的连通域个数
+// （矩形结构元的闭运算与阈值化可交换，结果与逐阈值二值化、闭运算、标记一致）
+static void runSweep(const cv::Mat& gray, const cv::Mat& kernel) {
+    auto start = std::chrono::steady_clock::now();
+    cv::Mat closed;
+    cv::morphologyEx(gray, closed, cv::MORPH_CLOSE, kernel);
+    ComponentTree tree;
+    tree.build(closed);
+    const std::vector<int> counts = tree.countsAllThresholds();
+    const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << "阈值扫描（" << tree.numNodes() << " 个树节点，耗时 " << std::fixed << std::setprecision(2) << ms
+              << " ms）：阈值:连通域数" << std::endl;
+    for (int t = 0; t < 256; ++t) std::cout << t << ":" << counts[t] << ((t % 8 == 7) ? "\n" : "\t");
+    std::cout << std::flush;
+}
+
+// 单图模式：cc_label [图像路径] [--profile 输出.json] [--sweep] [--format png|rle|raw]
 int main(int argc, char** argv) {
-    std::string imagePath = "../input.jpg";
-    if (argc > 1) imagePath = argv[1];
+    for (int i = 1; i < argc; ++i) {
+        if (std::string(argv[i]) == "--batch") return runBatch(argc, argv);
+        if (std::string(argv[i]) == "--sparse") return runSparse(argc, argv);
+#ifdef CC_HAVE_LABEL_SERVER
+        if (std::string(argv[i]) == "--serve") return runServe(argc, argv);
+#endif
+#ifdef CC_HAVE_MMAP
+        if (std::string(argv[i]) == "--out-of-core") return runOutOfCore(argc, argv);
+#endif
+    }
+
+    std::string imagePath = "../input.jpg", profilePath;
+    bool hasImage = false, sweep = false;
+    BatchPipeline::OutputFormat format = BatchPipeline::kColorPng;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--profile" && i + 1 < argc) profilePath = argv[++i];
+        else if (arg == "--sweep") sweep = true;
+        else if (arg == "--format" && i + 1 < argc) {
+            if (!parseFormat(argv[++i], format)) return -1;
+        }
+        else if (!hasImage) {
+            imagePath = arg;
+            hasImage = true;
+        }
+    }
+    if (!profilePath.empty() && !Instrumentation::enabled())
+        std::cerr << "未启用插桩（CC_ENABLE_INSTRUMENTATION=OFF），剖析结果只含总耗时" << std::endl;
 
     std::cout << "Trying to read: " << imagePath << std::endl;
     std::cout << "Current path: " << std::filesystem::current_path() << std::endl;
@@ -29,19 +337,30 @@ int main(int argc, char** argv) {
     // 形态学闭运算，填充空洞、连接断裂区域
     cv::Mat kernel = cv::getStructuringElement(cv::MORPH_RECT, cv::Size(3, 3));
     cv::morphologyEx(binary, binary, cv::MORPH_CLOSE, kernel);
+    if (sweep) runSweep(gray, kernel);
 
     ConnectedComponentsBFS bfs;
     // bfs.setEightConnectivity(true);
     ConnectedComponentsUF uf;
     // uf.setEightConnectivity(true);
+    ConnectedComponentsBBDT bbdt;
+    // bbdt.setEightConnectivity(true);
+    ConnectedComponentsParallel par;
+    // par.setEightConnectivity(true);
+    // par.setNumThreads(8);
+    ConnectedComponentsRLE rle;
+    // rle.setEightConnectivity(true);
+    ConnectedComponentsAuto autoSelect;
+    // autoSelect.setEightConnectivity(true);
 
-    std::vector<IComponentDetector*> detectors = { &bfs, &uf };
-    auto results = ComponentEvaluator::evaluate(binary, detectors);
+    std::vector<IComponentDetector*> detectors = { &bfs, &uf, &bbdt, &par, &rle, &autoSelect };
+    auto results = ComponentEvaluator::evaluate(binary, detectors, format == BatchPipeline::kColorPng);
+    std::cout << "自动选择: " << autoSelect.lastDecision().reason << std::endl;
 
 
     std::cout << "评估结果：" << std::endl;
     std::cout << "------------------------------------------------------" << std::endl;
-    std::cout << "算法名称\t\t连通域数\t\t耗时(ms)\t\t与基准一致率\tmeanIoU" << std::endl;
+    std::cout << "算法名称\t\t连通域数\t\t耗时(ms)\t\t与基准一致率\tmeanIoU\tARI" << std::endl;
     std::cout << "------------------------------------------------------" << std::endl;
 
     for (auto& r : results)
@@ -50,12 +369,25 @@ int main(int argc, char** argv) {
            << "\t\t" << std::fixed << std::setprecision(2) << r.timeMs
            << "\t\t" << (r.pixelAccuracy*100) << "%"
            << "\t" << std::fixed << std::setprecision(3) << r.meanIoU
+           << "\t" << r.adjustedRandIndex
            << std::endl;
+    if (!profilePath.empty() && writeProfile(profilePath, imagePath, binary, results))
+        std::cout << "剖析结果已保存: " << profilePath << std::endl;
     // 保存结果
     for (auto& r : results) {
-        std::string colorPath = r.name + "_color.png";
-        cv::imwrite(colorPath, r.color);
-        std::cout << "结果已保存: " << colorPath << std::endl;
+        std::string path;
+        bool ok;
+        if (format == BatchPipeline::kLabelsRle) {
+            path = r.name + "_labels.ccl";
+            ok = LabelMapIO::writeRle(path, r.labels, r.numComponents);
+        } else if (format == BatchPipeline::kLabelsRaw) {
+            path = r.name + "_labels.raw";
+            ok = LabelMapIO::writeRaw(path, r.labels, r.numComponents);
+        } else {
+            path = r.name + "_color.png";
+            ok = cv::imwrite(path, r.color);
+        }
+        if (ok) std::cout << "结果已保存: " << path << std::endl;
     }
     return 0;
 }